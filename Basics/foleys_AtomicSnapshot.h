@@ -0,0 +1,122 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+/**
+ @class AtomicSnapshot
+
+ The AtomicSnapshot holds an immutable object, that can be read from the realtime
+ threads without locking or allocating, while a new version is created and published
+ from the message thread (read-copy-update).
+
+ A reader keeps the ReadPointer for as long as it needs the object. An object that
+ was replaced by publish() is kept alive, until no reader is active any more. It is
+ then deleted in releaseRetired(), so the deallocation never happens on a reading thread.
+
+ publish() and releaseRetired() must always be called from the same thread, usually
+ the message thread.
+ */
+template<typename ObjectType>
+class AtomicSnapshot final
+{
+public:
+    AtomicSnapshot (std::unique_ptr<ObjectType> initialObject = std::make_unique<ObjectType>())
+    {
+        jassert (initialObject != nullptr);
+        current.store (initialObject.release());
+    }
+
+    ~AtomicSnapshot()
+    {
+        // somebody is still reading this snapshot!
+        jassert (numReaders.load() == 0);
+
+        retired.clear();
+        delete current.exchange (nullptr);
+    }
+
+    /**
+     The ReadPointer keeps the current object alive, as long as it exists.
+     It is meant to be used as a local variable for the time of one callback.
+     */
+    class ReadPointer final
+    {
+    public:
+        ReadPointer (const AtomicSnapshot& snapshotToRead)
+          : snapshot (snapshotToRead)
+        {
+            snapshot.numReaders.fetch_add (1);
+            object = snapshot.current.load();
+        }
+
+        ~ReadPointer()
+        {
+            snapshot.numReaders.fetch_sub (1);
+        }
+
+        const ObjectType& operator*() const  { return *object; }
+        const ObjectType* operator->() const { return object; }
+        const ObjectType* get() const        { return object; }
+
+    private:
+        const AtomicSnapshot& snapshot;
+        const ObjectType*     object = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE (ReadPointer)
+    };
+
+    /** Grab the current object. This is wait free and doesn't allocate. */
+    ReadPointer read() const
+    {
+        return ReadPointer (*this);
+    }
+
+    /** Replace the current object. The previous object is retired and deleted, once no reader is using it. */
+    void publish (std::unique_ptr<ObjectType> newObject)
+    {
+        jassert (newObject != nullptr);
+        retired.emplace_back (current.exchange (newObject.release()));
+        releaseRetired();
+    }
+
+    /** Deletes all retired objects, if there is currently no reader active.
+        Call this regularly from the publishing thread, e.g. from a timer. */
+    void releaseRetired()
+    {
+        if (! retired.empty() && numReaders.load() == 0)
+            retired.clear();
+    }
+
+    /** Returns the number of replaced objects that are waiting to be deleted */
+    size_t getNumRetired() const { return retired.size(); }
+
+private:
+    std::atomic<ObjectType*>                 current { nullptr };
+    mutable std::atomic<int>                 numReaders { 0 };
+    std::vector<std::unique_ptr<ObjectType>> retired;
+
+    JUCE_DECLARE_NON_COPYABLE (AtomicSnapshot)
+};
+
+} // foleys
@@ -0,0 +1,153 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+
+namespace foleys
+{
+
+bool FrameCache::Key::operator== (const Key& other) const
+{
+    return timecode == other.timecode
+        && stateHash == other.stateHash
+        && stream == other.stream
+        && width == other.width
+        && height == other.height
+        && media == other.media;
+}
+
+size_t FrameCache::KeyHash::operator() (const Key& key) const
+{
+    auto hash = size_t (key.media.hashCode64());
+    hash = hash * 31 + size_t (key.stream);
+    hash = hash * 31 + size_t (key.timecode);
+    hash = hash * 31 + size_t (key.width);
+    hash = hash * 31 + size_t (key.height);
+    return hash * 31 + size_t (key.stateHash);
+}
+
+FrameCache::FrameCache (size_t maximumSizeInBytes)
+  : maximumSize (maximumSizeInBytes)
+{
+}
+
+juce::Image FrameCache::getFrame (const Key& key)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto it = lookup.find (key);
+    if (it == lookup.end())
+        return {};
+
+    // move to the front as most recently used
+    entries.splice (entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+void FrameCache::addFrame (const Key& key, const juce::Image& image)
+{
+    const auto size = getImageSize (image);
+
+    const juce::ScopedLock sl (lock);
+
+    if (size > maximumSize)
+        return;
+
+    auto it = lookup.find (key);
+    if (it != lookup.end())
+    {
+        currentSize -= getImageSize (it->second->second);
+        it->second->second = image;
+        entries.splice (entries.begin(), entries, it->second);
+    }
+    else
+    {
+        entries.emplace_front (key, image);
+        lookup [key] = entries.begin();
+    }
+
+    currentSize += size;
+    evict (maximumSize);
+}
+
+void FrameCache::setMaximumSize (size_t maximumSizeInBytes)
+{
+    const juce::ScopedLock sl (lock);
+    maximumSize = maximumSizeInBytes;
+    evict (maximumSize);
+}
+
+size_t FrameCache::getMaximumSize() const
+{
+    const juce::ScopedLock sl (lock);
+    return maximumSize;
+}
+
+size_t FrameCache::getCurrentSize() const
+{
+    const juce::ScopedLock sl (lock);
+    return currentSize;
+}
+
+void FrameCache::clear()
+{
+    const juce::ScopedLock sl (lock);
+    evict (0);
+}
+
+void FrameCache::addReader (const juce::String& media)
+{
+    const juce::ScopedLock sl (lock);
+    ++numReaders [media];
+}
+
+void FrameCache::removeReader (const juce::String& media)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto it = numReaders.find (media);
+    if (it != numReaders.end() && --it->second <= 0)
+        numReaders.erase (it);
+}
+
+bool FrameCache::isShared (const juce::String& media) const
+{
+    const juce::ScopedLock sl (lock);
+
+    auto it = numReaders.find (media);
+    return it != numReaders.end() && it->second > 1;
+}
+
+void FrameCache::evict (size_t targetSize)
+{
+    while (currentSize > targetSize && ! entries.empty())
+    {
+        auto& last = entries.back();
+        currentSize -= getImageSize (last.second);
+        lookup.erase (last.first);
+        entries.pop_back();
+    }
+}
+
+size_t FrameCache::getImageSize (const juce::Image& image)
+{
+    return size_t (image.getWidth()) * size_t (image.getHeight()) * (image.getFormat() == juce::Image::SingleChannel ? 1 : 4);
+}
+
+} // foleys
@@ -0,0 +1,108 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+/**
+ @class FrameCache
+
+ The FrameCache holds decoded video frames of all readers of the VideoEngine. When the
+ same media is used several times in a timeline, e.g. as B-roll or as picture-in-picture,
+ the readers share the converted images instead of converting each frame again.
+
+ The images are shared by reference, so the users must not draw into them. The least
+ recently used frames are dropped, once the cache exceeds its maximum size.
+
+ The readers register the media they read. A reader only shares the frames of media,
+ that is read by another reader as well, otherwise it reuses it's own buffers.
+ */
+class FrameCache final
+{
+public:
+    /** Identifies a decoded frame: the media, the stream, the timecode in the stream's
+        timebase and the size of the image. The stateHash distinguishes images of the same
+        frame produced from different states, e.g. composed frames of different edits. */
+    struct Key
+    {
+        juce::String media;
+        int          stream    = 0;
+        int64_t      timecode  = -1;
+        int          width     = 0;
+        int          height    = 0;
+        juce::uint64 stateHash = 0;
+
+        bool operator== (const Key& other) const;
+    };
+
+    /** Creates a FrameCache with a maximum size in bytes */
+    FrameCache (size_t maximumSizeInBytes = 512 * 1024 * 1024);
+
+    /** Returns the cached image or an invalid image, if the frame is not in the cache */
+    juce::Image getFrame (const Key& key);
+
+    /** Adds a decoded frame to the cache, dropping the least recently used frames if needed */
+    void addFrame (const Key& key, const juce::Image& image);
+
+    /** Set the maximum memory the images in the cache may use in bytes */
+    void setMaximumSize (size_t maximumSizeInBytes);
+    size_t getMaximumSize() const;
+
+    /** Returns the memory used by the images in the cache in bytes */
+    size_t getCurrentSize() const;
+
+    /** Drops all cached frames */
+    void clear();
+
+    /** Registers a reader of the media, readers call this in AVReader::setFrameCache() */
+    void addReader (const juce::String& media);
+    void removeReader (const juce::String& media);
+
+    /** Returns true, if more than one reader reads the media, so sharing frames can save work */
+    bool isShared (const juce::String& media) const;
+
+private:
+    struct KeyHash
+    {
+        size_t operator() (const Key& key) const;
+    };
+
+    using Entry = std::pair<Key, juce::Image>;
+
+    void evict (size_t targetSize);
+
+    static size_t getImageSize (const juce::Image& image);
+
+    juce::CriticalSection lock;
+
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup;
+
+    size_t maximumSize = 0;
+    size_t currentSize = 0;
+
+    std::map<juce::String, int> numReaders;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FrameCache)
+};
+
+} // foleys
@@ -0,0 +1,556 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+namespace foleys
+{
+
+/** identifies the file format and the byte order of the pixels, "FRC2" in little endian */
+static constexpr juce::int32 renderCacheMagic = 0x32435246;
+
+static const char* const renderCacheExtension = ".frc";
+
+/** the number of lines coded independently, so they can be processed in parallel */
+static constexpr int renderCacheBandLines = 64;
+
+//==============================================================================
+// A QOI style codec for the 4 byte pixels. It is lossless and much faster than deflate,
+// since each pixel is coded as a run, a reference to a recent pixel or a small difference.
+
+static int getPixelHash (const juce::uint8* pixel)
+{
+    return (pixel [0] * 3 + pixel [1] * 5 + pixel [2] * 7 + pixel [3] * 11) % 64;
+}
+
+/** Writes the lines into output, which needs space for 5 bytes per pixel. Returns the number of bytes written */
+static size_t encodeLines (const juce::Image::BitmapData& data, int startLine, int endLine, juce::uint8* output)
+{
+    juce::uint8 recent [64][4] = {};
+    juce::uint8 previous [4] = { 0, 0, 0, 255 };
+
+    auto* out = output;
+    int   run = 0;
+
+    for (int y = startLine; y < endLine; ++y)
+    {
+        const auto* pixel = data.getLinePointer (y);
+        for (int x = 0; x < data.width; ++x, pixel += 4)
+        {
+            if (std::memcmp (pixel, previous, 4) == 0)
+            {
+                if (++run == 62)
+                {
+                    *out++ = juce::uint8 (0xc0 | (run - 1));
+                    run = 0;
+                }
+
+                continue;
+            }
+
+            if (run > 0)
+            {
+                *out++ = juce::uint8 (0xc0 | (run - 1));
+                run = 0;
+            }
+
+            const auto hash = getPixelHash (pixel);
+            if (std::memcmp (recent [hash], pixel, 4) == 0)
+            {
+                *out++ = juce::uint8 (hash);
+            }
+            else if (pixel [3] != previous [3])
+            {
+                *out++ = 0xff;
+                std::memcpy (out, pixel, 4);
+                out += 4;
+            }
+            else
+            {
+                const auto d0 = int (juce::int8 (juce::uint8 (pixel [0] - previous [0])));
+                const auto d1 = int (juce::int8 (juce::uint8 (pixel [1] - previous [1])));
+                const auto d2 = int (juce::int8 (juce::uint8 (pixel [2] - previous [2])));
+
+                if (d0 >= -2 && d0 <= 1 && d1 >= -2 && d1 <= 1 && d2 >= -2 && d2 <= 1)
+                {
+                    *out++ = juce::uint8 (0x40 | (d0 + 2) << 4 | (d1 + 2) << 2 | (d2 + 2));
+                }
+                else if (d1 >= -32 && d1 <= 31 && d0 - d1 >= -8 && d0 - d1 <= 7 && d2 - d1 >= -8 && d2 - d1 <= 7)
+                {
+                    *out++ = juce::uint8 (0x80 | (d1 + 32));
+                    *out++ = juce::uint8 ((d0 - d1 + 8) << 4 | (d2 - d1 + 8));
+                }
+                else
+                {
+                    *out++ = 0xfe;
+                    std::memcpy (out, pixel, 3);
+                    out += 3;
+                }
+            }
+
+            std::memcpy (recent [hash], pixel, 4);
+            std::memcpy (previous, pixel, 4);
+        }
+    }
+
+    if (run > 0)
+        *out++ = juce::uint8 (0xc0 | (run - 1));
+
+    return size_t (out - output);
+}
+
+/** Reads the lines encoded by encodeLines(). Returns false, if the input is corrupt */
+static bool decodeLines (const juce::uint8* input, size_t size, const juce::Image::BitmapData& data, int startLine, int endLine)
+{
+    juce::uint8 recent [64][4] = {};
+    juce::uint8 pixel [4] = { 0, 0, 0, 255 };
+
+    const auto* in  = input;
+    const auto* end = input + size;
+    int         run = 0;
+
+    for (int y = startLine; y < endLine; ++y)
+    {
+        auto* target = data.getLinePointer (y);
+        for (int x = 0; x < data.width; ++x, target += 4)
+        {
+            if (run > 0)
+            {
+                --run;
+            }
+            else
+            {
+                if (in >= end)
+                    return false;
+
+                const auto op = *in++;
+                if (op == 0xff)
+                {
+                    if (end - in < 4)
+                        return false;
+
+                    std::memcpy (pixel, in, 4);
+                    in += 4;
+                }
+                else if (op == 0xfe)
+                {
+                    if (end - in < 3)
+                        return false;
+
+                    std::memcpy (pixel, in, 3);
+                    in += 3;
+                }
+                else if ((op & 0xc0) == 0x00)
+                {
+                    std::memcpy (pixel, recent [op], 4);
+                }
+                else if ((op & 0xc0) == 0x40)
+                {
+                    pixel [0] = juce::uint8 (pixel [0] + ((op >> 4) & 3) - 2);
+                    pixel [1] = juce::uint8 (pixel [1] + ((op >> 2) & 3) - 2);
+                    pixel [2] = juce::uint8 (pixel [2] + (op & 3) - 2);
+                }
+                else if ((op & 0xc0) == 0x80)
+                {
+                    if (in >= end)
+                        return false;
+
+                    const auto next = *in++;
+                    const auto d1 = (op & 0x3f) - 32;
+                    pixel [0] = juce::uint8 (pixel [0] + d1 - 8 + ((next >> 4) & 0x0f));
+                    pixel [1] = juce::uint8 (pixel [1] + d1);
+                    pixel [2] = juce::uint8 (pixel [2] + d1 - 8 + (next & 0x0f));
+                }
+                else
+                {
+                    // this pixel and run more
+                    run = op & 0x3f;
+                }
+
+                std::memcpy (recent [getPixelHash (pixel)], pixel, 4);
+            }
+
+            std::memcpy (target, pixel, 4);
+        }
+    }
+
+    return true;
+}
+
+class RenderCacheEncodeJob : public WorkerPool::Job
+{
+public:
+    RenderCacheEncodeJob (const juce::Image::BitmapData& dataToUse, int numBands)
+      : data (dataToUse), bands (size_t (numBands)), sizes (size_t (numBands))
+    {
+    }
+
+    void runTask (int index) override
+    {
+        const auto startLine = index * renderCacheBandLines;
+        const auto endLine   = std::min (startLine + renderCacheBandLines, data.height);
+
+        auto& band = bands [size_t (index)];
+        band.setSize (size_t (endLine - startLine) * size_t (data.width) * 5);
+        sizes [size_t (index)] = encodeLines (data, startLine, endLine, static_cast<juce::uint8*> (band.getData()));
+    }
+
+    const juce::Image::BitmapData& data;
+    std::vector<juce::MemoryBlock> bands;
+    std::vector<size_t>            sizes;
+};
+
+class RenderCacheDecodeJob : public WorkerPool::Job
+{
+public:
+    RenderCacheDecodeJob (const juce::MemoryBlock& fileDataToUse, const juce::Image::BitmapData& dataToUse,
+                          const std::vector<size_t>& offsetsToUse)
+      : fileData (fileDataToUse), data (dataToUse), offsets (offsetsToUse)
+    {
+    }
+
+    void runTask (int index) override
+    {
+        const auto startLine = index * renderCacheBandLines;
+        const auto endLine   = std::min (startLine + renderCacheBandLines, data.height);
+        const auto* input    = static_cast<const juce::uint8*> (fileData.getData()) + offsets [size_t (index)];
+
+        if (! decodeLines (input, offsets [size_t (index) + 1] - offsets [size_t (index)], data, startLine, endLine))
+            failed = true;
+    }
+
+    std::atomic<bool> failed { false };
+
+private:
+    const juce::MemoryBlock&       fileData;
+    const juce::Image::BitmapData& data;
+    const std::vector<size_t>&     offsets;
+};
+
+//==============================================================================
+
+RenderCache::RenderCache (WorkerPool* workerPoolToUse)
+  : workerPool (workerPoolToUse)
+{
+}
+
+void RenderCache::setDirectory (const juce::File& directoryToUse)
+{
+    const juce::ScopedLock sl (lock);
+
+    directory = directoryToUse;
+    entries.clear();
+    usageOrder.clear();
+    currentSize = 0;
+
+    if (directory == juce::File())
+        return;
+
+    if (! directory.createDirectory())
+    {
+        FOLEYS_LOG ("Could not create render cache: " << directory.getFullPathName());
+        directory = juce::File();
+        return;
+    }
+
+    // leftovers of an interrupted write and frames of earlier versions
+    for (const auto& file : directory.findChildFiles (juce::File::findFiles, false, "*.tmp;*.jpg;*.png;*.argb"))
+        file.deleteFile();
+
+    auto files = directory.findChildFiles (juce::File::findFiles, false, juce::String ("*") + renderCacheExtension);
+
+    // the modification time is the last use, so the order of use is restored
+    std::sort (files.begin(), files.end(), [](const auto& a, const auto& b)
+    {
+        return a.getLastModificationTime() < b.getLastModificationTime();
+    });
+
+    for (const auto& file : files)
+        setEntry (file.getFileNameWithoutExtension(), file, file.getLastModificationTime());
+
+    evict (maximumSize);
+}
+
+juce::File RenderCache::getDirectory() const
+{
+    const juce::ScopedLock sl (lock);
+    return directory;
+}
+
+bool RenderCache::isEnabled() const
+{
+    const juce::ScopedLock sl (lock);
+    return directory != juce::File();
+}
+
+juce::Image RenderCache::getFrame (juce::uint64 stateHash, Size size)
+{
+    const auto name = getEntryName (stateHash, size);
+    const auto now  = juce::Time::getCurrentTime();
+
+    juce::File file;
+    bool       touch = false;
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        auto it = entries.find (name);
+        if (it == entries.end())
+            return {};
+
+        // the modification time keeps the age across sessions, but doesn't need updating each frame
+        touch = now - it->second.lastUsed > juce::RelativeTime::hours (1);
+        it->second.lastUsed = now;
+        usageOrder.splice (usageOrder.end(), usageOrder, it->second.usage);
+        file = it->second.file;
+    }
+
+    auto image = readImage (file, size);
+
+    if (! image.isValid())
+    {
+        const juce::ScopedLock sl (lock);
+
+        auto it = entries.find (name);
+        if (it != entries.end() && it->second.file == file)
+            removeEntry (it);
+
+        return {};
+    }
+
+    if (touch)
+        file.setLastModificationTime (now);
+
+    return image;
+}
+
+bool RenderCache::containsFrame (juce::uint64 stateHash, Size size) const
+{
+    const juce::ScopedLock sl (lock);
+    return entries.find (getEntryName (stateHash, size)) != entries.end();
+}
+
+void RenderCache::addFrame (juce::uint64 stateHash, const juce::Image& image)
+{
+    if (! image.isValid())
+        return;
+
+    const auto targetDirectory = getDirectory();
+    if (targetDirectory == juce::File())
+        return;
+
+    const auto name = getEntryName (stateHash, { image.getWidth(), image.getHeight() });
+    const auto file = targetDirectory.getChildFile (name + renderCacheExtension);
+    const auto temp = targetDirectory.getChildFile (name + ".tmp").getNonexistentSibling (false);
+
+    // the file is written under a temporary name, so no reader ever sees a partial file
+    auto written = false;
+    {
+        juce::FileOutputStream stream (temp);
+        if (! stream.openedOk())
+            return;
+
+        // a full disk only shows in the status, once the buffered data is written
+        written = writeImage (image, stream);
+        stream.flush();
+        written = written && stream.getStatus().wasOk();
+    }
+
+    if (! written || ! temp.moveFileTo (file))
+    {
+        temp.deleteFile();
+        return;
+    }
+
+    const juce::ScopedLock sl (lock);
+
+    // the directory was changed while writing
+    if (directory != targetDirectory)
+        return;
+
+    setEntry (name, file, juce::Time::getCurrentTime());
+    evict (maximumSize);
+}
+
+void RenderCache::setMaximumSize (juce::int64 maximumSizeInBytes)
+{
+    const juce::ScopedLock sl (lock);
+    maximumSize = maximumSizeInBytes;
+    evict (maximumSize);
+}
+
+juce::int64 RenderCache::getMaximumSize() const
+{
+    const juce::ScopedLock sl (lock);
+    return maximumSize;
+}
+
+void RenderCache::setMaximumAge (juce::RelativeTime maximumAgeToUse)
+{
+    const juce::ScopedLock sl (lock);
+    maximumAge = maximumAgeToUse;
+    evict (maximumSize);
+}
+
+juce::RelativeTime RenderCache::getMaximumAge() const
+{
+    const juce::ScopedLock sl (lock);
+    return maximumAge;
+}
+
+juce::int64 RenderCache::getCurrentSize() const
+{
+    const juce::ScopedLock sl (lock);
+    return currentSize;
+}
+
+void RenderCache::clear()
+{
+    const juce::ScopedLock sl (lock);
+    evict (0);
+}
+
+void RenderCache::setEntry (const juce::String& name, const juce::File& file, juce::Time lastUsed)
+{
+    auto it = entries.find (name);
+    if (it != entries.end())
+    {
+        currentSize -= it->second.size;
+        usageOrder.erase (it->second.usage);
+    }
+
+    auto& entry = entries [name];
+    entry.file     = file;
+    entry.size     = file.getSize();
+    entry.lastUsed = lastUsed;
+    entry.usage    = usageOrder.insert (usageOrder.end(), name);
+
+    currentSize += entry.size;
+}
+
+void RenderCache::evict (juce::int64 targetSize)
+{
+    const auto expired = juce::Time::getCurrentTime() - maximumAge;
+
+    // the usage order is sorted by the time of use, so expired and surplus entries are at the front
+    while (! usageOrder.empty())
+    {
+        auto it = entries.find (usageOrder.front());
+        jassert (it != entries.end());
+
+        if (currentSize <= targetSize && it->second.lastUsed >= expired)
+            break;
+
+        removeEntry (it);
+    }
+}
+
+RenderCache::EntryMap::iterator RenderCache::removeEntry (EntryMap::iterator it)
+{
+    it->second.file.deleteFile();
+    currentSize -= it->second.size;
+    usageOrder.erase (it->second.usage);
+    return entries.erase (it);
+}
+
+juce::String RenderCache::getEntryName (juce::uint64 stateHash, Size size)
+{
+    return juce::String::toHexString (juce::int64 (stateHash)).paddedLeft ('0', 16)
+           + "_" + juce::String (size.width) + "x" + juce::String (size.height);
+}
+
+bool RenderCache::writeImage (const juce::Image& image, juce::OutputStream& stream) const
+{
+    // the composed frames are ARGB already, the pixels are coded as they are in memory
+    const auto argb = image.convertedToFormat (juce::Image::ARGB);
+    const juce::Image::BitmapData data (argb, juce::Image::BitmapData::readOnly);
+    jassert (data.pixelStride == 4);
+
+    const auto numBands = (data.height + renderCacheBandLines - 1) / renderCacheBandLines;
+
+    RenderCacheEncodeJob job (data, numBands);
+    if (workerPool != nullptr)
+        workerPool->run (job, numBands);
+    else
+        for (int band = 0; band < numBands; ++band)
+            job.runTask (band);
+
+    if (! stream.writeInt (renderCacheMagic) || ! stream.writeInt (data.width) || ! stream.writeInt (data.height)
+        || ! stream.writeInt (numBands))
+        return false;
+
+    for (auto size : job.sizes)
+        if (! stream.writeInt (int (size)))
+            return false;
+
+    for (size_t band = 0; band < job.bands.size(); ++band)
+        if (! stream.write (job.bands [band].getData(), job.sizes [band]))
+            return false;
+
+    return true;
+}
+
+juce::Image RenderCache::readImage (const juce::File& file, Size size) const
+{
+    juce::MemoryBlock fileData;
+    if (! file.loadFileAsData (fileData))
+        return {};
+
+    juce::MemoryInputStream stream (fileData, false);
+    const auto numBands = (size.height + renderCacheBandLines - 1) / renderCacheBandLines;
+
+    if (stream.readInt() != renderCacheMagic || stream.readInt() != size.width || stream.readInt() != size.height
+        || stream.readInt() != numBands)
+        return {};
+
+    // the start of each band in fileData and the end of the last one
+    std::vector<size_t> offsets (size_t (numBands) + 1);
+    offsets [0] = size_t (4 + numBands) * sizeof (juce::int32);
+
+    for (size_t band = 0; band < size_t (numBands); ++band)
+    {
+        const auto bandSize = stream.readInt();
+        if (bandSize < 0)
+            return {};
+
+        offsets [band + 1] = offsets [band] + size_t (bandSize);
+    }
+
+    if (offsets.back() > fileData.getSize())
+        return {};
+
+    juce::Image image (juce::Image::ARGB, size.width, size.height, false);
+    {
+        const juce::Image::BitmapData data (image, juce::Image::BitmapData::writeOnly);
+        jassert (data.pixelStride == 4);
+
+        RenderCacheDecodeJob job (fileData, data, offsets);
+        if (workerPool != nullptr)
+            workerPool->run (job, numBands);
+        else
+            for (int band = 0; band < numBands; ++band)
+                job.runTask (band);
+
+        if (job.failed)
+            return {};
+    }
+
+    return image;
+}
+
+} // foleys
@@ -0,0 +1,123 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+class WorkerPool;
+
+/**
+ @class RenderCache
+
+ The RenderCache keeps pre-rendered composed frames on disk, so sections too heavy to
+ composite in realtime can be played from the cache. Each frame is an image file named
+ after the hash of the edit state it was composited from, so the files stay valid across
+ sessions and an edit simply stops matching the frames it changed.
+
+ The frames are stored lossless as premultiplied ARGB, so a frame read from the cache is
+ identical to compositing it, also when rendering the final output. The pixels are compressed
+ with a fast QOI style codec in bands of lines, which are encoded and decoded in parallel on
+ the WorkerPool, so 4K frames can be read in realtime. The cache is
+ disabled until a directory is set. Files are evicted, when they were not used for longer than
+ the maximum age, or least recently used first, when the cache exceeds its maximum size.
+ */
+class RenderCache final
+{
+public:
+    /** Creates the cache. The WorkerPool encodes and decodes the bands of a frame in parallel */
+    RenderCache (WorkerPool* workerPool = nullptr);
+
+    /** Set the directory to keep the files in. The existing files are picked up, so a cache
+        survives restarts. An invalid File disables the cache. */
+    void setDirectory (const juce::File& directory);
+    juce::File getDirectory() const;
+
+    /** Returns true, if a directory was set */
+    bool isEnabled() const;
+
+    /** Returns the cached frame or an invalid image, if the frame is not in the cache */
+    juce::Image getFrame (juce::uint64 stateHash, Size size);
+
+    /** Returns true, if the frame is in the cache without reading it */
+    bool containsFrame (juce::uint64 stateHash, Size size) const;
+
+    /** Writes a frame to the cache, evicting the least recently used files if needed */
+    void addFrame (juce::uint64 stateHash, const juce::Image& image);
+
+    /** Set the maximum size of all files in bytes. Default is 4 GB */
+    void setMaximumSize (juce::int64 maximumSizeInBytes);
+    juce::int64 getMaximumSize() const;
+
+    /** Files not used for that time are deleted. Default is 7 days */
+    void setMaximumAge (juce::RelativeTime maximumAgeToUse);
+    juce::RelativeTime getMaximumAge() const;
+
+    /** Returns the size of all files in the cache in bytes */
+    juce::int64 getCurrentSize() const;
+
+    /** Deletes all files of the cache */
+    void clear();
+
+private:
+    struct Entry
+    {
+        juce::File  file;
+        juce::int64 size = 0;
+        juce::Time  lastUsed;
+
+        /** the position in the usage order */
+        std::list<juce::String>::iterator usage;
+    };
+
+    using EntryMap = std::map<juce::String, Entry>;
+
+    static juce::String getEntryName (juce::uint64 stateHash, Size size);
+
+    bool writeImage (const juce::Image& image, juce::OutputStream& stream) const;
+    juce::Image readImage (const juce::File& file, Size size) const;
+
+    /** Adds or replaces the entry as the most recently used one */
+    void setEntry (const juce::String& name, const juce::File& file, juce::Time lastUsed);
+
+    /** Deletes expired files and the least recently used ones above the target size */
+    void evict (juce::int64 targetSize);
+
+    EntryMap::iterator removeEntry (EntryMap::iterator it);
+
+    WorkerPool* workerPool = nullptr;
+
+    juce::CriticalSection lock;
+
+    juce::File              directory;
+    EntryMap                entries;
+
+    /** the entry names, least recently used first */
+    std::list<juce::String> usageOrder;
+
+    juce::int64        maximumSize = juce::int64 (4) * 1024 * 1024 * 1024;
+    juce::RelativeTime maximumAge  = juce::RelativeTime::days (7);
+    juce::int64        currentSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderCache)
+};
+
+} // foleys
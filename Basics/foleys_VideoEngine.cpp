@@ -120,6 +120,26 @@ juce::ThreadPool& VideoEngine::getThreadPool()
     return jobThreads;
 }
 
+WorkerPool& VideoEngine::getAudioWorkerPool()
+{
+    return audioWorkers;
+}
+
+WorkerPool& VideoEngine::getVideoWorkerPool()
+{
+    return videoWorkers;
+}
+
+FrameCache& VideoEngine::getFrameCache()
+{
+    return frameCache;
+}
+
+RenderCache& VideoEngine::getRenderCache()
+{
+    return renderCache;
+}
+
 void VideoEngine::timerCallback()
 {
     for (auto p = releasePool.begin(); p != releasePool.end();)
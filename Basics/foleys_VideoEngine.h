@@ -60,6 +60,30 @@ public:
 
     juce::ThreadPool& getThreadPool();
 
+    /**
+     The WorkerPool to process audio in parallel, e.g. the clips in the DefaultAudioMixer.
+     Unlike the ThreadPool it can be used from the audio thread, its workers are realtime threads.
+     Hand it the workgroup of your audio device with WorkerPool::setAudioWorkgroup().
+     */
+    WorkerPool& getAudioWorkerPool();
+
+    /**
+     The WorkerPool to render video in parallel, e.g. the bands of a composited frame.
+     */
+    WorkerPool& getVideoWorkerPool();
+
+    /**
+     The FrameCache shares decoded video frames between all clips reading the same media.
+     Use setMaximumSize() on it to adjust the memory it may use.
+     */
+    FrameCache& getFrameCache();
+
+    /**
+     The RenderCache keeps pre-rendered frames of ComposedClips on disk, see
+     ComposedClip::renderToCache(). It is disabled until you call setDirectory() on it.
+     */
+    RenderCache& getRenderCache();
+
     /**
      This method will add the clip to the background threads and hold an auto
      release pool to make sure, it won't be deleted in any realtime critical thread.
@@ -133,6 +157,13 @@ private:
 
     juce::OptionalScopedPointer<juce::UndoManager> undoManager { new juce::UndoManager(), true };
 
+    // the pools outlive the caches and the threads using them
+    WorkerPool audioWorkers { "Audio Worker", juce::jlimit (1, 8, juce::SystemStats::getNumCpus() - 1), 9, true };
+    WorkerPool videoWorkers { "Video Worker", juce::jlimit (1, 16, juce::SystemStats::getNumCpus() - 1), 5 };
+
+    FrameCache frameCache;
+    RenderCache renderCache { &videoWorkers };
+
     juce::ThreadPool jobThreads { std::max (4, juce::SystemStats::getNumCpus()) };
     std::vector<std::unique_ptr<juce::TimeSliceThread>> readingThreads;
 
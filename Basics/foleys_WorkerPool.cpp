@@ -0,0 +1,159 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+
+namespace foleys
+{
+
+WorkerPool::WorkerPool (const juce::String& name, int numThreads, int priority, bool realtime)
+{
+    for (int i = 0; i < numThreads; ++i)
+        workers.emplace_back (std::make_unique<Worker> (*this, name + " #" + juce::String (i)));
+
+    for (auto& worker : workers)
+    {
+#if JUCE_MAJOR_VERSION >= 7
+        if (realtime && worker->startRealtimeThread (juce::Thread::RealtimeOptions().withPriority (priority)))
+            continue;
+#else
+        juce::ignoreUnused (realtime);
+#endif
+
+        worker->startThread (priority);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+
+    for (auto& worker : workers)
+    {
+        worker->notify();
+        worker->stopThread (1000);
+    }
+}
+
+void WorkerPool::run (Job& job, int numTasksToRun)
+{
+    const juce::SpinLock::ScopedTryLockType tryLock (runLock);
+
+    if (workers.empty() || numTasksToRun < 2 || ! tryLock.isLocked())
+    {
+        for (int task = 0; task < numTasksToRun; ++task)
+            job.runTask (task);
+
+        return;
+    }
+
+    nextTask    = 0;
+    numFinished = 0;
+    numTasks    = numTasksToRun;
+    currentJob  = &job;
+
+    const auto numToWake = std::min (int (workers.size()), numTasksToRun - 1);
+    for (int i = 0; i < numToWake; ++i)
+        workers [size_t (i)]->notify();
+
+    processTasks();
+
+    while (numFinished.load() < numTasksToRun)
+        juce::Thread::yield();
+
+    // a worker might still hold the pointer to the job without finding a task
+    currentJob = nullptr;
+    while (numActiveThreads.load() > 0)
+        juce::Thread::yield();
+}
+
+void WorkerPool::processTasks()
+{
+    ++numActiveThreads;
+
+    if (auto* job = currentJob.load())
+    {
+        const auto total = numTasks.load();
+        for (auto task = nextTask.fetch_add (1); task < total; task = nextTask.fetch_add (1))
+        {
+            job->runTask (task);
+            ++numFinished;
+        }
+    }
+
+    --numActiveThreads;
+}
+
+int WorkerPool::getNumThreads() const
+{
+    return int (workers.size());
+}
+
+#if JUCE_VERSION >= 0x70006
+void WorkerPool::setAudioWorkgroup (const juce::AudioWorkgroup& workgroupToJoin)
+{
+    juce::ScopedLock sl (workgroupLock);
+    workgroup = workgroupToJoin;
+    ++workgroupGeneration;
+}
+#endif
+
+//==============================================================================
+
+WorkerPool::Worker::Worker (WorkerPool& owner, const juce::String& name)
+  : juce::Thread (name),
+    pool (owner)
+{
+}
+
+void WorkerPool::Worker::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (-1);
+
+        if (threadShouldExit())
+            return;
+
+#if JUCE_VERSION >= 0x70006
+        joinWorkgroup();
+#endif
+
+        pool.processTasks();
+    }
+}
+
+#if JUCE_VERSION >= 0x70006
+void WorkerPool::Worker::joinWorkgroup()
+{
+    const auto generation = pool.workgroupGeneration.load();
+    if (generation == joinedGeneration)
+        return;
+
+    juce::ScopedLock sl (pool.workgroupLock);
+    workgroupToken.reset();
+    if (pool.workgroup)
+        pool.workgroup.join (workgroupToken);
+
+    joinedGeneration = generation;
+}
+#endif
+
+} // foleys
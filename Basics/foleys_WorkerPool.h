@@ -0,0 +1,124 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+/**
+ @class WorkerPool
+
+ The WorkerPool runs a number of independent tasks on a set of threads, that are
+ started once and sleep while there is nothing to do. The calling thread takes part
+ in the work and returns when all tasks are finished.
+
+ Unlike the juce::ThreadPool it doesn't allocate and doesn't wait for other jobs
+ when running tasks. The exception is waking the workers: that signals their
+ juce::WaitableEvent, which briefly takes the event's mutex. Only the worker and
+ run() use that mutex, so it is hardly ever contended, but it is not strictly lock free.
+
+ While the workers finish, the calling thread yields. To use the pool from the audio
+ thread, create it with realtime workers and let them join the device's workgroup
+ with setAudioWorkgroup(), otherwise a preempted worker delays the audio thread.
+ Realtime workers need JUCE 7, older versions start them with the given priority.
+
+ Only one run() can be active at a time. If the pool is busy, e.g. because a nested
+ ComposedClip mixes from within a worker, the tasks are executed on the calling thread.
+ */
+class WorkerPool final
+{
+public:
+    /** Implement this interface to split your work into tasks */
+    class Job
+    {
+    public:
+        virtual ~Job() = default;
+
+        /** This is called once for each task index, possibly concurrently from different threads */
+        virtual void runTask (int taskIndex) = 0;
+    };
+
+    /**
+     Creates the pool and starts the threads.
+     @param name is used for the thread names
+     @param numThreads is the number of threads in addition to the calling thread
+     @param priority is the juce::Thread priority of the workers
+     @param realtime starts the workers as realtime threads, for pools used from the audio thread
+     */
+    WorkerPool (const juce::String& name, int numThreads, int priority = 5, bool realtime = false);
+
+    ~WorkerPool();
+
+    /** Runs all tasks of the job and returns, when they are all finished. */
+    void run (Job& job, int numTasks);
+
+    /** Returns the number of worker threads, not counting the calling thread */
+    int getNumThreads() const;
+
+#if JUCE_VERSION >= 0x70006
+    /**
+     Lets the workers join the workgroup of the audio device, e.g. AudioIODevice::getWorkgroup(),
+     so the system schedules them together with the audio thread. They join, when they are woken next.
+     */
+    void setAudioWorkgroup (const juce::AudioWorkgroup& workgroupToJoin);
+#endif
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker (WorkerPool& owner, const juce::String& name);
+        void run() override;
+
+    private:
+        WorkerPool& pool;
+
+#if JUCE_VERSION >= 0x70006
+        void joinWorkgroup();
+
+        juce::WorkgroupToken workgroupToken;
+        int                  joinedGeneration = 0;
+#endif
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+    };
+
+    void processTasks();
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    juce::SpinLock    runLock;
+
+    std::atomic<Job*> currentJob { nullptr };
+    std::atomic<int>  numTasks { 0 };
+    std::atomic<int>  nextTask { 0 };
+    std::atomic<int>  numFinished { 0 };
+    std::atomic<int>  numActiveThreads { 0 };
+
+#if JUCE_VERSION >= 0x70006
+    juce::CriticalSection workgroupLock;
+    juce::AudioWorkgroup  workgroup;
+    std::atomic<int>      workgroupGeneration { 0 };
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerPool)
+};
+
+} // foleys
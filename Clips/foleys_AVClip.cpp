@@ -78,6 +78,16 @@ void AVClip::setAspectType (Aspect type)
     zoomType = type;
 }
 
+void AVClip::setApplyAudioGain (bool shouldApplyGain)
+{
+    applyAudioGain = shouldApplyGain;
+}
+
+bool AVClip::shouldApplyAudioGain() const
+{
+    return applyAudioGain.load();
+}
+
 const ParameterMap& AVClip::getVideoParameters()
 {
     return videoParameters;
@@ -91,6 +101,10 @@ const ParameterMap& AVClip::getAudioParameters()
 void AVClip::addAudioParameter (std::unique_ptr<ProcessorParameter> parameter)
 {
     parameter->setParameterIndex (int (audioParameters.size() + 1));
+
+    if (parameter->getParameterID() == IDs::gain)
+        audioGainParameter = parameter.get();
+
     audioParameters [parameter->getParameterID()] = std::move (parameter);
 }
 
@@ -100,6 +114,14 @@ void AVClip::addVideoParameter (std::unique_ptr<ProcessorParameter> parameter)
     videoParameters [parameter->getParameterID()] = std::move (parameter);
 }
 
+float AVClip::getAudioGain() const
+{
+    if (audioGainParameter == nullptr)
+        return 1.0f;
+
+    return float (juce::Decibels::decibelsToGain (audioGainParameter->getRealValue()));
+}
+
 juce::TimeSliceClient* AVClip::getBackgroundJob()
 {
     return nullptr;
@@ -117,41 +139,48 @@ void AVClip::renderFrame (juce::Graphics& g, juce::Rectangle<float> area, VideoF
 
     juce::Graphics::ScopedSaveState state (g);
 
-    juce::AffineTransform transformation;
+    const auto transformation = Compositor::getFrameTransform ({ frame.image.getWidth(), frame.image.getHeight() },
+                                                               area, zoomType, rotation, zoom, translation);
 
-    const auto factorX = area.getWidth() / frame.image.getWidth();
-    const auto factorY = area.getHeight() / frame.image.getHeight();
+    g.setOpacity (alpha);
+    g.drawImageTransformed (frame.image, transformation);
+}
 
-    juce::Point<float> offset;
+juce::AffineTransform AVClip::getFrameTransform (juce::Rectangle<float> area, float rotation, float zoom, juce::Point<float> translation) const
+{
+    return Compositor::getFrameTransform (getVideoSize(), area, zoomType, rotation, zoom, translation);
+}
 
-    if (zoomType == Aspect::LetterBox)
-    {
-        const auto factor = std::min (factorX, factorY);
-        transformation = transformation.scale (factor);
-        offset.setXY ((area.getWidth() - frame.image.getWidth() * factor) * 0.5f,
-                      (area.getHeight() - frame.image.getHeight() * factor) * 0.5f);
-    }
-    else if (zoomType == Aspect::Crop)
-    {
-        const auto factor = std::max (factorX, factorY);
-        transformation = transformation.scale (factor);
-        offset.setXY ((area.getWidth() - frame.image.getWidth() * factor) * 0.5f,
-                      (area.getHeight() - frame.image.getHeight() * factor) * 0.5f);
-    }
-    else if (zoomType == Aspect::ZoomScale)
-    {
-        transformation = transformation.scale (factorX, factorY);
-    }
+void AVClip::renderInto (juce::Image& target, juce::Rectangle<float> area, double pts, float rotation, float zoom, juce::Point<float> translation, float alpha)
+{
+    Compositor::LayerList layers;
+    addLayers (layers, area, pts, rotation, zoom, translation, alpha);
+
+    auto* engine = getVideoEngine();
+    Compositor::drawLayers (target, layers, engine != nullptr ? &engine->getVideoWorkerPool() : nullptr);
+}
+
+void AVClip::addLayers (Compositor::LayerList& layers, juce::Rectangle<float> area, double pts, float rotation, float zoom, juce::Point<float> translation, float alpha)
+{
+    const auto& frame = getFrame (pts);
+    if (frame.image.isNull() || alpha <= 0.0f)
+        return;
 
-    transformation = transformation.translated (area.getX(), area.getY());
+    layers.push_back ({ frame.image,
+                        Compositor::getFrameTransform ({ frame.image.getWidth(), frame.image.getHeight() },
+                                                       area, zoomType, rotation, zoom, translation),
+                        alpha, Compositor::Sampling::bilinear, isOpaque() });
+}
 
-    transformation = transformation.rotated (juce::degreesToRadians (rotation), area.getCentreX(), area.getCentreY())
-                                   .scaled (zoom * 0.01f, zoom * 0.01f, area.getCentreX(), area.getCentreY())
-                                   .translated (area.getWidth() * translation.x, area.getHeight() * translation.y);
+void AVClip::renderFrameInto (juce::Image& target, juce::Rectangle<float> area, const VideoFrame& frame, float rotation, float zoom, juce::Point<float> translation, float alpha)
+{
+    if (frame.image.isNull())
+        return;
 
-    g.setOpacity (alpha);
-    g.setOrigin (offset.roundToInt());
-    g.drawImageTransformed (frame.image, transformation);
+    const auto transformation = Compositor::getFrameTransform ({ frame.image.getWidth(), frame.image.getHeight() },
+                                                               area, zoomType, rotation, zoom, translation);
+
+    Compositor::drawImage (target, frame.image, transformation, alpha);
 }
 
 #if FOLEYS_USE_OPENGL
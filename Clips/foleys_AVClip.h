@@ -77,6 +77,42 @@ public:
     /** Renders a frame on the OpenGLView. You can call this from the AVClip subclasses */
     void renderFrame (juce::Graphics& g, juce::Rectangle<float> area, VideoFrame& frame, float rotation, float zoom, juce::Point<float> translation, float alpha);
 
+    /**
+     Composites the frame for pts into the target image using the Compositor. This is the fast
+     path for producing video frames, render() with a juce::Graphics is meant for the GUI.
+     The default implementation composites the layers from addLayers() using the video WorkerPool.
+     */
+    virtual void renderInto (juce::Image& target, juce::Rectangle<float> area, double pts, float rotation = 0.0f, float zoom = 100.0f, juce::Point<float> translation = juce::Point<float>(), float alpha = 1.0f);
+
+    /**
+     Adds the images, that make up the frame for pts, to the layers to be composited into area.
+     The default implementation adds the image returned by getFrame(). A clip consisting of
+     several images can add each of them, so they are composited in one pass.
+     */
+    virtual void addLayers (Compositor::LayerList& layers, juce::Rectangle<float> area, double pts, float rotation = 0.0f, float zoom = 100.0f, juce::Point<float> translation = juce::Point<float>(), float alpha = 1.0f);
+
+    /** Returns the transform, that places a frame of getVideoSize() into area like renderFrame() */
+    juce::AffineTransform getFrameTransform (juce::Rectangle<float> area, float rotation, float zoom, juce::Point<float> translation) const;
+
+    /** Returns true, if every pixel of the frames is opaque, so clips below are hidden by this clip */
+    virtual bool isOpaque() const { return false; }
+
+    /**
+     Tells the clip, that the frames before pts won't be shown, e.g. because an opaque clip covers
+     it in the composition. A clip may skip preparing these frames. Call it with 0 to reset.
+     */
+    virtual void discardVideoUntil (double pts) { juce::ignoreUnused (pts); }
+
+    /**
+     Returns a number identifying the image shown at pts. Times returning the same number show the
+     same image, so a composition or a writer can reuse the previous frame. The default returns -1,
+     meaning the image may change at any time.
+     */
+    virtual juce::int64 getFrameIdentifier (double pts) { juce::ignoreUnused (pts); return -1; }
+
+    /** Composites a frame into the target image like renderFrame() does into a juce::Graphics */
+    void renderFrameInto (juce::Image& target, juce::Rectangle<float> area, const VideoFrame& frame, float rotation, float zoom, juce::Point<float> translation, float alpha);
+
 #if FOLEYS_USE_OPENGL
     /** This is the virtual render() method for OpenGL rendering */
     virtual void render (OpenGLView& view, double pts, float rotation = 0.0f, float zoom = 100.0f, juce::Point<float> translation = juce::Point<float>(), float alpha = 1.0f) = 0;
@@ -132,6 +168,13 @@ public:
         return true;
     }
 
+    /**
+     If the gain is applied by the AudioMixer sample accurate, the clip must not apply
+     it's gain parameter in getNextAudioBlock(). The DefaultAudioMixer sets this to false.
+     */
+    void setApplyAudioGain (bool shouldApplyGain);
+    bool shouldApplyAudioGain() const;
+
     static void addDefaultAudioParameters (AVClip& clip);
     static void addDefaultVideoParameters (AVClip& clip);
 
@@ -151,6 +194,10 @@ protected:
     void addAudioParameter (std::unique_ptr<ProcessorParameter> parameter);
     void addVideoParameter (std::unique_ptr<ProcessorParameter> parameter);
 
+    /** Returns the linear gain of the gain parameter, or 1.0 if the clip has no gain.
+        The parameter is resolved when added, so this can be called in the audio callback. */
+    float getAudioGain() const;
+
     //==============================================================================
 
 private:
@@ -158,9 +205,13 @@ private:
 
     Aspect zoomType = Aspect::LetterBox;
 
+    std::atomic<bool> applyAudioGain { true };
+
     ParameterMap videoParameters;
     ParameterMap audioParameters;
 
+    ProcessorParameter* audioGainParameter = nullptr;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AVClip)
 };
 
@@ -113,7 +113,7 @@ void AudioClip::releaseResources()
 
 void AudioClip::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
 {
-    const auto gain = float (juce::Decibels::decibelsToGain (getAudioParameters().at(IDs::gain)->getRealValue()));
+    const auto gain = getAudioGain();
 
     if (resampler.get() != nullptr)
         resampler->getNextAudioBlock (info);
@@ -122,7 +122,9 @@ void AudioClip::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
     else
         info.clearActiveBufferRegion();
 
-    info.buffer->applyGainRamp (info.startSample, info.numSamples, lastGain, gain);
+    if (shouldApplyAudioGain())
+        info.buffer->applyGainRamp (info.startSample, info.numSamples, lastGain, gain);
+
     lastGain = gain;
 }
 
@@ -40,6 +40,41 @@ namespace IDs
     static juce::String     aspectScale     { "scale" };
 }
 
+/** Copies the pixels of two images of the same size and format */
+static void copyPixels (const juce::Image& source, juce::Image& target)
+{
+    const juce::Image::BitmapData sourceData (source, juce::Image::BitmapData::readOnly);
+    juce::Image::BitmapData targetData (target, juce::Image::BitmapData::writeOnly);
+
+    jassert (sourceData.width == targetData.width && sourceData.height == targetData.height && sourceData.pixelStride == targetData.pixelStride);
+
+    const auto lineSize = size_t (sourceData.width * sourceData.pixelStride);
+    for (int y = 0; y < sourceData.height; ++y)
+        std::memcpy (targetData.getLinePointer (y), sourceData.getLinePointer (y), lineSize);
+}
+
+/** Runs processRegion() of a separable VideoProcessor for each of the regions */
+class VideoProcessorRegionJob : public WorkerPool::Job
+{
+public:
+    VideoProcessorRegionJob (VideoProcessor& processorToUse, const juce::Image& inputToUse, juce::Image& outputToUse,
+                             const std::vector<juce::Rectangle<int>>& regionsToUse)
+      : processor (processorToUse), input (inputToUse), output (outputToUse), regions (regionsToUse)
+    {
+    }
+
+    void runTask (int index) override
+    {
+        processor.processRegion (input, output, regions [size_t (index)]);
+    }
+
+private:
+    VideoProcessor&                           processor;
+    const juce::Image&                        input;
+    juce::Image&                              output;
+    const std::vector<juce::Rectangle<int>>&  regions;
+};
+
 ClipDescriptor::ClipDescriptor (ComposedClip& ownerToUse, std::shared_ptr<AVClip> clipToUse, juce::UndoManager* undo)
   : owner (ownerToUse),
     undoManager (undo)
@@ -59,6 +94,9 @@ ClipDescriptor::ClipDescriptor (ComposedClip& ownerToUse, std::shared_ptr<AVClip
     audioParameterController.setClip (clip->getAudioParameters(), state.getOrCreateChildWithName (IDs::audioParameters, nullptr), undoManager);
     videoParameterController.setClip (clip->getVideoParameters(), state.getOrCreateChildWithName (IDs::videoParameters, nullptr), undoManager);
 
+    resolveParameterHandles();
+    updateRenderState();
+    updateVideoStateHash();
     state.addListener (this);
 }
 
@@ -89,6 +127,10 @@ ClipDescriptor::ClipDescriptor (ComposedClip& ownerToUse, juce::ValueTree stateT
                 addVideoProcessor (std::make_unique<ProcessorController>(*this, videoProcessor, undoManager, -1));
         }
     }
+
+    resolveParameterHandles();
+    updateRenderState();
+    updateVideoStateHash();
     state.addListener (this);
 }
 
@@ -133,7 +175,7 @@ void ClipDescriptor::setVideoVisible (bool shouldBeVisible)
 
 bool ClipDescriptor::getVideoVisible() const
 {
-    return state.getProperty (IDs::visible, true);
+    return videoVisible.load();
 }
 
 void ClipDescriptor::setAudioPlaying (bool shouldPlay)
@@ -143,7 +185,37 @@ void ClipDescriptor::setAudioPlaying (bool shouldPlay)
 
 bool ClipDescriptor::getAudioPlaying() const
 {
-    return state.getProperty (IDs::audio, true);
+    return audioPlaying.load();
+}
+
+void ClipDescriptor::setAudioBus (const juce::String& busName)
+{
+    state.setProperty (IDs::bus, busName, undoManager);
+}
+
+juce::String ClipDescriptor::getAudioBus() const
+{
+    return state.getProperty (IDs::bus).toString();
+}
+
+int ClipDescriptor::getAudioBusIndex() const
+{
+    return audioBusIndex.load();
+}
+
+void ClipDescriptor::setAudioStem (const juce::String& stemName)
+{
+    state.setProperty (IDs::stem, stemName, undoManager);
+}
+
+juce::String ClipDescriptor::getAudioStem() const
+{
+    return state.getProperty (IDs::stem).toString();
+}
+
+int ClipDescriptor::getAudioStemIndex() const
+{
+    return audioStemIndex.load();
 }
 
 double ClipDescriptor::getCurrentTimeInSeconds() const
@@ -183,28 +255,45 @@ void ClipDescriptor::removeListener (Listener* listener)
 }
 
 void ClipDescriptor::valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
-                                               const juce::Identifier&)
+                                               const juce::Identifier& property)
 {
+    if (isVideoProcessorChain (treeWhosePropertyHasChanged.getParent()) && (property == IDs::identifier || property == IDs::active))
+        updateVideoStateHash();
+
     if (treeWhosePropertyHasChanged != state)
         return;
 
-    if (clip.get() != nullptr && state.hasProperty (IDs::aspect))
+    if (property == IDs::start || property == IDs::length || property == IDs::offset)
     {
-        const auto aspect = state.getProperty (IDs::aspect).toString();
-        if (aspect == IDs::aspectLetterbox)
-            clip->setAspectType (Aspect::LetterBox);
-        else if (aspect == IDs::aspectCrop)
-            clip->setAspectType (Aspect::Crop);
-        else if (aspect == IDs::aspectScale)
-            clip->setAspectType (Aspect::ZoomScale);
+        if (owner.isInBatchEdit())
+            owner.pendingSampleCounts = true;
+        else
+            updateSampleCounts();
+
+        // the read position depends on start and offset
+        preRolled = false;
+        owner.publishClips();
     }
+    else if (property == IDs::visible || property == IDs::audio || property == IDs::aspect)
+    {
+        if (property == IDs::aspect)
+            updateVideoStateHash();
 
-    updateSampleCounts();
+        updateRenderState();
+        owner.invalidateVideo();
+    }
+    else if (property == IDs::bus || property == IDs::stem)
+    {
+        owner.publishClips();
+    }
 }
 
 void ClipDescriptor::valueTreeChildAdded (juce::ValueTree& parentTree,
                                           juce::ValueTree& childWhichHasBeenAdded)
 {
+    if (isVideoProcessorChain (parentTree))
+        updateVideoStateHash();
+
     if (manualStateChange)
         return;
 
@@ -221,6 +310,9 @@ void ClipDescriptor::valueTreeChildRemoved (juce::ValueTree& parentTree,
                                             juce::ValueTree&,
                                             int indexFromWhichChildWasRemoved)
 {
+    if (isVideoProcessorChain (parentTree))
+        updateVideoStateHash();
+
     if (manualStateChange)
         return;
 
@@ -231,6 +323,182 @@ void ClipDescriptor::valueTreeChildRemoved (juce::ValueTree& parentTree,
         removeVideoProcessor (indexFromWhichChildWasRemoved);
 }
 
+bool ClipDescriptor::isVideoProcessorChain (const juce::ValueTree& tree) const
+{
+    return tree.isValid() && tree.getType() == IDs::videoProcessors && tree.getParent() == state;
+}
+
+void ClipDescriptor::updateVideoStateHash()
+{
+    // only the chain itself: the parameter values are hashed per frame, and automation or
+    // keyframe edits must not invalidate frames they don't change
+    auto hash = juce::uint64 (state.getProperty (IDs::aspect).toString().hashCode64());
+
+    for (const auto& processor : state.getChildWithName (IDs::videoProcessors))
+    {
+        hash = hash * 31 + juce::uint64 (processor.getProperty (IDs::identifier).toString().hashCode64());
+        hash = hash * 31 + (bool (processor.getProperty (IDs::active, true)) ? 1 : 0);
+    }
+
+    videoStateHash = hash;
+}
+
+bool ClipDescriptor::hasActiveVideoProcessors() const
+{
+    return std::any_of (videoProcessors.begin(), videoProcessors.end(), [](const auto& controller) { return controller->isActive(); });
+}
+
+juce::Image ClipDescriptor::getProcessedFrame (double pts, const VideoStreamSettings& settings)
+{
+    // the fifo slot of the frame may be reused, while the frame is processed
+    const auto& frame    = clip->getFrame (pts);
+    const auto  source   = frame.image.convertedToFormat (juce::Image::ARGB);
+    const auto  timecode = frame.timecode;
+    auto*       engine   = owner.getVideoEngine();
+
+    if (source.isNull() || engine == nullptr)
+        return source;
+
+    // adding or removing processors takes this lock too, it also keeps the processors to one thread.
+    // It is not the ComposedClip's lock, so edits of other clips don't wait for the processing
+    juce::ScopedLock sl (videoProcessingLock);
+
+    if (! hasActiveVideoProcessors())
+        return source;
+
+    // the processor chain is part of the state hash, the automation adds the values at pts
+    auto hash = getVideoStateHash();
+    const auto combine = [&hash](double value)
+    {
+        juce::uint64 bits;
+        std::memcpy (&bits, &value, sizeof (bits));
+        hash = hash * 31 + bits;
+    };
+
+    auto timeDependent = false;
+    for (const auto& controller : videoProcessors)
+    {
+        if (! controller->isActive())
+            continue;
+
+        if (auto* processor = controller->getVideoProcessor())
+            timeDependent = timeDependent || processor->isTimeDependent();
+
+        for (const auto& parameter : controller->getParameters())
+            combine (parameter.second->getValueForTime (pts));
+    }
+
+    if (timeDependent)
+        combine (pts);
+
+    const auto frameIdentifier = clip->getFrameIdentifier (pts);
+    if (frameIdentifier >= 0)
+        hash = hash * 31 + juce::uint64 (frameIdentifier);
+
+    // the source frame is identified like in the readers, clips without media by their address
+    auto media = clip->getMediaFile().toString (true);
+    if (media.isEmpty())
+        media = juce::String::toHexString (juce::pointer_sized_int (clip.get()));
+
+    const FrameCache::Key key { "processed:" + media, 0, timecode, source.getWidth(), source.getHeight(), hash };
+
+    auto& cache = engine->getFrameCache();
+    auto  processed = cache.getFrame (key);
+    if (processed.isValid())
+        return processed;
+
+    // the source is shared with the clip's fifo and the FrameCache, so the processors work on a copy
+    processed = getProcessingBuffer (source.getWidth(), source.getHeight());
+    copyPixels (source, processed);
+
+    const auto count = convertTimecode (pts - getOffset(), settings);
+    for (const auto& controller : videoProcessors)
+    {
+        if (! controller->isActive())
+            continue;
+
+        controller->updateAutomation (pts);
+        if (auto* processor = controller->getVideoProcessor())
+            processVideoFrame (*processor, processed, count, settings);
+    }
+
+    cache.addFrame (key, processed);
+    return processed;
+}
+
+juce::Image ClipDescriptor::getProcessingBuffer (int width, int height)
+{
+    juce::Image* unused = nullptr;
+
+    // a buffer only referenced by the pool is free to be overwritten
+    for (auto& buffer : processingBuffers)
+    {
+        if (buffer.getReferenceCount() > 1)
+            continue;
+
+        if (buffer.getWidth() == width && buffer.getHeight() == height)
+            return buffer;
+
+        unused = &buffer;
+    }
+
+    auto buffer = juce::Image (juce::Image::ARGB, width, height, false);
+
+    // the pooled buffers become free, once the FrameCache dropped them
+    if (unused != nullptr)
+        *unused = buffer;
+    else if (processingBuffers.size() < 4)
+        processingBuffers.push_back (buffer);
+
+    return buffer;
+}
+
+void ClipDescriptor::processVideoFrame (VideoProcessor& processor, juce::Image& frame, int64_t count, const VideoStreamSettings& settings)
+{
+    const auto separability = processor.getSeparability();
+    auto* engine = owner.getVideoEngine();
+
+    if (separability == VideoProcessor::Separability::none || engine == nullptr)
+    {
+        processor.processFrame (frame, count, settings, getLength());
+        return;
+    }
+
+    if (! processor.prepareRegions (frame, count, settings, getLength()))
+        return;
+
+    auto& pool = engine->getVideoWorkerPool();
+    const auto width  = frame.getWidth();
+    const auto height = frame.getHeight();
+
+    // bands like the Compositor uses, tiles of roughly tileSize squared
+    const int tileSize = 128;
+    const auto numRows = separability == VideoProcessor::Separability::tiles
+                       ? (height + tileSize - 1) / tileSize
+                       : juce::jlimit (1, std::max (1, height / 16), (pool.getNumThreads() + 1) * 4);
+    const auto numColumns = separability == VideoProcessor::Separability::tiles
+                          ? (width + tileSize - 1) / tileSize
+                          : 1;
+
+    std::vector<juce::Rectangle<int>> regions;
+    regions.reserve (size_t (numRows * numColumns));
+    for (int row = 0; row < numRows; ++row)
+        for (int column = 0; column < numColumns; ++column)
+            regions.push_back (juce::Rectangle<int>::leftTopRightBottom (width * column / numColumns, height * row / numRows,
+                                                                         width * (column + 1) / numColumns, height * (row + 1) / numRows));
+
+    // with a halo the regions read their neighbours' pixels, so they need the unprocessed frame
+    auto input = frame;
+    if (processor.getRegionHalo() > 0)
+    {
+        input = getProcessingBuffer (width, height);
+        copyPixels (frame, input);
+    }
+
+    VideoProcessorRegionJob job (processor, input, frame, regions);
+    pool.run (job, int (regions.size()));
+}
+
 void ClipDescriptor::updateSampleCounts()
 {
     start  = state.getProperty (IDs::start);
@@ -243,6 +511,23 @@ void ClipDescriptor::updateSampleCounts()
     offsetSamples = juce::int64 (sampleRate * offset);
 }
 
+void ClipDescriptor::updateRenderState()
+{
+    videoVisible = bool (state.getProperty (IDs::visible, true));
+    audioPlaying = bool (state.getProperty (IDs::audio, true));
+
+    if (clip.get() != nullptr && state.hasProperty (IDs::aspect))
+    {
+        const auto aspect = state.getProperty (IDs::aspect).toString();
+        if (aspect == IDs::aspectLetterbox)
+            clip->setAspectType (Aspect::LetterBox);
+        else if (aspect == IDs::aspectCrop)
+            clip->setAspectType (Aspect::Crop);
+        else if (aspect == IDs::aspectScale)
+            clip->setAspectType (Aspect::ZoomScale);
+    }
+}
+
 ClipDescriptor::ClipParameterController& ClipDescriptor::getAudioParameterController()
 {
     return audioParameterController;
@@ -253,6 +538,59 @@ ClipDescriptor::ClipParameterController& ClipDescriptor::getVideoParameterContro
     return videoParameterController;
 }
 
+void ClipDescriptor::resolveParameterHandles()
+{
+    alphaHandle      = videoParameterController.getParameterHandle (IDs::alpha);
+    zoomHandle       = videoParameterController.getParameterHandle (IDs::zoom);
+    translateXHandle = videoParameterController.getParameterHandle (IDs::translateX);
+    translateYHandle = videoParameterController.getParameterHandle (IDs::translateY);
+    rotationHandle   = videoParameterController.getParameterHandle (IDs::rotation);
+    gainHandle       = audioParameterController.getParameterHandle (IDs::gain);
+}
+
+ClipDescriptor::VideoTransform ClipDescriptor::getVideoTransformAt (double pts) const
+{
+    VideoTransform transform;
+    transform.alpha      = float (videoParameterController.getHandleValueAtTime (alphaHandle, pts, 1.0));
+    transform.zoom       = videoParameterController.getHandleValueAtTime (zoomHandle, pts, 1.0);
+    transform.translateX = videoParameterController.getHandleValueAtTime (translateXHandle, pts, 0.0);
+    transform.translateY = videoParameterController.getHandleValueAtTime (translateYHandle, pts, 0.0);
+    transform.rotation   = videoParameterController.getHandleValueAtTime (rotationHandle, pts, 0.0);
+    return transform;
+}
+
+bool ClipDescriptor::isVideoTransformChangingBetween (double startTime, double endTime) const
+{
+    for (auto handle : { alphaHandle, zoomHandle, translateXHandle, translateYHandle, rotationHandle })
+        if (auto* parameter = videoParameterController.getParameter (handle))
+            if (parameter->isChangingBetween (startTime, endTime))
+                return true;
+
+    return false;
+}
+
+ParameterAutomation* ClipDescriptor::getAudioGainAutomation() const
+{
+    return audioParameterController.getParameter (gainHandle);
+}
+
+void ClipDescriptor::takeOverDecoder()
+{
+    auto* previous = decoderSource.exchange (nullptr);
+    if (previous == nullptr)
+        return;
+
+    auto* movieClip = dynamic_cast<MovieClip*> (clip.get());
+    auto* previousClip = dynamic_cast<MovieClip*> (previous->clip.get());
+    if (movieClip == nullptr || previousClip == nullptr)
+        return;
+
+    // if the clip was seeked meanwhile, it keeps it's own decoder
+    if (! preRolled.exchange (true))
+        if (! movieClip->takeOverDecoder (*previousClip))
+            preRolled = false;
+}
+
 juce::ValueTree& ClipDescriptor::getStatusTree()
 {
     return state;
@@ -323,6 +661,7 @@ void ClipDescriptor::addVideoProcessor (std::unique_ptr<ProcessorController> con
 
     {
         juce::ScopedLock sl (owner.getCallbackLock());
+        juce::ScopedLock pl (videoProcessingLock);
         if (juce::isPositiveAndBelow (index, videoProcessors.size()))
             videoProcessors.insert (std::next (videoProcessors.begin(), index), std::move (controller));
         else
@@ -351,6 +690,7 @@ void ClipDescriptor::removeVideoProcessor (int index)
     processorsNode.removeChild (index, undoManager);
 
     juce::ScopedLock sl (owner.getCallbackLock());
+    juce::ScopedLock pl (videoProcessingLock);
     videoProcessors.erase (toBeRemoved);
 }
 
@@ -372,6 +712,7 @@ void ClipDescriptor::removeProcessor (ProcessorController* controller)
         }
 
         juce::ScopedLock sl (owner.getCallbackLock());
+        juce::ScopedLock pl (videoProcessingLock);
         videoProcessors.erase (videoToBeRemoved);
 
         return;
@@ -454,6 +795,8 @@ void ClipDescriptor::ClipParameterController::setClip (const ParameterMap& param
         }
         parameters [parameter.second->getParameterID()] = std::make_unique<VideoParameterAutomation> (*this, *parameter.second, node, undo);
     }
+
+    updateParameterHandles();
 }
 
 AutomationMap& ClipDescriptor::ClipParameterController::getParameters()
@@ -471,18 +814,27 @@ double ClipDescriptor::ClipParameterController::getCurrentPTS() const
     return getTimeReference().getCurrentTimeInSeconds();
 }
 
+bool ClipDescriptor::ClipParameterController::isDeferringUpdates() const
+{
+    if (auto* descriptor = dynamic_cast<const ClipDescriptor*> (&getTimeReference()))
+        return descriptor->getOwningClip().isInBatchEdit();
+
+    return false;
+}
+
 double ClipDescriptor::ClipParameterController::getValueAtTime (juce::Identifier paramID, double pts, double defaultValue)
 {
-    if (auto* parameter = parameters [paramID].get())
-        return parameter->getRealValueForTime (pts);
+    auto parameter = parameters.find (paramID);
+    if (parameter != parameters.end() && parameter->second != nullptr)
+        return parameter->second->getRealValueForTime (pts);
 
     return defaultValue;
 }
 
 void ClipDescriptor::ClipParameterController::updateAutomations (double pts)
 {
-    for (auto& parameter : parameters)
-        parameter.second->updateProcessor (pts);
+    for (auto* parameter : getParameterList())
+        parameter->updateProcessor (pts);
 }
 
 
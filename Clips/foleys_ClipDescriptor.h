@@ -94,6 +94,23 @@ public:
     void setAudioPlaying (bool shouldPlay);
     bool getAudioPlaying() const;
 
+    /** Route the audio to the AudioBus with that name. An empty name or a name
+        without a matching bus plays the clip directly on the master */
+    void setAudioBus (const juce::String& busName);
+    juce::String getAudioBus() const;
+
+    /** The index of the routed bus in the bus list the mixer receives, or -1 for the
+        master. This is resolved by the ComposedClip each time the buses change */
+    int getAudioBusIndex() const;
+
+    /** Assign the audio to an output stem of the ComposedClip. This is only used, if the
+        clip plays on the master, otherwise the stem of the AudioBus applies */
+    void setAudioStem (const juce::String& stemName);
+    juce::String getAudioStem() const;
+
+    /** The index of the stem in ComposedClip::getAudioStems() or -1 if not assigned */
+    int getAudioStemIndex() const;
+
     /** Transforms a time relative to the containing clip into a local time in ClipDescriptor. */
     double getClipTimeInDescriptorTime (double time) const;
 
@@ -108,9 +125,48 @@ public:
 
     void updateSampleCounts();
 
+    /** Reads the flags for visibility and audio and the aspect from the state.
+        The cached values are used in the audio and render callbacks. */
+    void updateRenderState();
+
     ClipParameterController& getAudioParameterController();
     ClipParameterController& getVideoParameterController();
 
+    /** The automated geometry of the clip used for compositing */
+    struct VideoTransform
+    {
+        float  alpha      = 1.0f;
+        double zoom       = 1.0;
+        double translateX = 0.0;
+        double translateY = 0.0;
+        double rotation   = 0.0;
+    };
+
+    /** Evaluates the geometric parameters at the time in clip time. The parameters are
+        resolved once when the clip is set, so this is cheap enough for each frame. */
+    VideoTransform getVideoTransformAt (double pts) const;
+
+    /** Returns true, if any of the geometric parameters is automated to change between the times in clip time */
+    bool isVideoTransformChangingBetween (double startTime, double endTime) const;
+
+    /** A hash of the aspect and the types, order and active state of the video processors, updated
+        on each change. Together with the media and the parameter values at a time it identifies what
+        the clip contributes to a composed frame. It only depends on the state, so it is the same in
+        the next session. */
+    juce::uint64 getVideoStateHash() const  { return videoStateHash; }
+
+    /** Returns the automation of the clip's gain or nullptr, if the clip has no gain parameter */
+    ParameterAutomation* getAudioGainAutomation() const;
+
+    /** True in the block, where this clip continues the media of the previous clip. A mixer must
+        process it after the other clips and call takeOverDecoder() first, so the previous clip
+        rendered up to the cut from the same decoder. */
+    bool isWaitingForDecoder() const  { return decoderSource.load() != nullptr; }
+
+    /** Continues with the decoder of the previous clip, if isWaitingForDecoder(). If the handover
+        fails, the ComposedClip seeks this clip after the block. */
+    void takeOverDecoder();
+
     void addProcessor (juce::ValueTree tree, int index = -1);
 
     void addAudioProcessor (std::unique_ptr<ProcessorController> controller, int index=-1);
@@ -127,6 +183,20 @@ public:
 
     const std::vector<std::unique_ptr<ProcessorController>>& getVideoProcessors() const;
 
+    /** Returns true, if at least one video processor is active */
+    bool hasActiveVideoProcessors() const;
+
+    /**
+     Returns the frame of the clip at pts in clip time with the active video processors applied.
+     The processors work on a copy in a pooled buffer, so the frame of the clip is never changed.
+     The result is kept in the FrameCache of the VideoEngine per source frame, processor chain and
+     parameter values, so showing a frame again, e.g. while paused or in another view, doesn't
+     process it again. Without active processors this returns the frame of the clip.
+     @param pts is the time in the clip, like the automation time
+     @param settings are passed to the processors, the count is the time since the start of the clip
+     */
+    juce::Image getProcessedFrame (double pts, const VideoStreamSettings& settings);
+
     ComposedClip& getOwningClip();
     const ComposedClip& getOwningClip() const;
 
@@ -179,6 +249,8 @@ public:
 
         double getCurrentPTS() const override;
 
+        bool isDeferringUpdates() const override;
+
         void updateAutomations (double pts);
 
     private:
@@ -200,6 +272,39 @@ private:
     std::atomic<int64_t> lengthSamples  = 0;
     std::atomic<int64_t> offsetSamples  = 0;
 
+    std::atomic<bool>    videoVisible { true };
+    std::atomic<bool>    audioPlaying { true };
+    std::atomic<int>     audioBusIndex { -1 };
+    std::atomic<int>     audioStemIndex { -1 };
+
+    /** set by the ComposedClip, once the clip was seeked for the current playhead */
+    std::atomic<bool>    preRolled { false };
+
+    /** set by the ComposedClip to the continued clip in the block, where the decoder is handed over */
+    std::atomic<ClipDescriptor*> decoderSource { nullptr };
+
+    std::atomic<juce::uint64> videoStateHash { 0 };
+
+    int alphaHandle      = -1;
+    int zoomHandle       = -1;
+    int translateXHandle = -1;
+    int translateYHandle = -1;
+    int rotationHandle   = -1;
+    int gainHandle       = -1;
+
+    void resolveParameterHandles();
+
+    /** Returns true, if the tree is the list of video processors of this clip */
+    bool isVideoProcessorChain (const juce::ValueTree& tree) const;
+
+    void updateVideoStateHash();
+
+    /** Returns a buffer of that size from the pool, that is not used anywhere else */
+    juce::Image getProcessingBuffer (int width, int height);
+
+    /** Runs the processor on the frame, split into regions on the video WorkerPool if it supports that */
+    void processVideoFrame (VideoProcessor& processor, juce::Image& frame, int64_t count, const VideoStreamSettings& settings);
+
     void valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
                                    const juce::Identifier& property) override;
 
@@ -210,7 +315,11 @@ private:
                                 juce::ValueTree& childWhichHasBeenRemoved,
                                 int indexFromWhichChildWasRemoved) override;
 
-    void valueTreeChildOrderChanged (juce::ValueTree&, int, int) override {}
+    void valueTreeChildOrderChanged (juce::ValueTree& parentTree, int, int) override
+    {
+        if (isVideoProcessorChain (parentTree))
+            updateVideoStateHash();
+    }
 
     void valueTreeParentChanged (juce::ValueTree&) override {}
 
@@ -225,6 +334,12 @@ private:
     std::vector<std::unique_ptr<ProcessorController>> videoProcessors;
     std::vector<std::unique_ptr<ProcessorController>> audioProcessors;
 
+    /** buffers for the processed frames, reused once the FrameCache and the views let go of them */
+    std::vector<juce::Image> processingBuffers;
+
+    /** held while processing a frame and while the video processors are added or removed */
+    juce::CriticalSection    videoProcessingLock;
+
     friend ComposedClip;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClipDescriptor)
@@ -0,0 +1,200 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+
+namespace foleys
+{
+
+ClipTimeline::ClipTimeline (ClipList clipsToUse, BusList busesToUse)
+  : clips (std::move (clipsToUse)),
+    buses (std::move (busesToUse))
+{
+    struct Event
+    {
+        double time;
+        size_t index;
+        bool   isStart;
+    };
+
+    std::vector<Event> events;
+    events.reserve (clips.size() * 2);
+
+    for (size_t index = 0; index < clips.size(); ++index)
+    {
+        const auto& descriptor = clips [index];
+        const auto start = descriptor->getStart();
+        const auto end   = start + descriptor->getLength();
+
+        totalLength     = std::max (totalLength, descriptor->getStartInSamples() + descriptor->getLengthInSamples());
+        lengthInSeconds = std::max (lengthInSeconds, end);
+
+        if (auto* nested = dynamic_cast<ComposedClip*> (descriptor->clip.get()))
+        {
+            nestedClips.push_back (nested);
+        }
+        else if (descriptor->clip != nullptr)
+        {
+            anyVideo |= descriptor->clip->hasVideo();
+            anyAudio |= descriptor->clip->hasAudio();
+        }
+
+        if (end <= start)
+            continue;
+
+        events.push_back ({ start, index, true });
+        events.push_back ({ end,   index, false });
+    }
+
+    std::sort (events.begin(), events.end(), [](const auto& a, const auto& b)
+    {
+        return a.time < b.time || (a.time == b.time && a.index < b.index);
+    });
+
+    std::set<size_t> active;
+    auto event = events.begin();
+    while (event != events.end())
+    {
+        Segment segment;
+        segment.start = event->time;
+
+        for (; event != events.end() && event->time == segment.start; ++event)
+        {
+            if (event->isStart)
+            {
+                active.insert (event->index);
+                segment.started.push_back (event->index);
+            }
+            else
+            {
+                active.erase (event->index);
+            }
+        }
+
+        segment.indices.assign (active.begin(), active.end());
+        segment.clips.reserve (active.size());
+        for (auto index : active)
+            segment.clips.push_back (clips [index]);
+
+        maximumOverlap = std::max (maximumOverlap, active.size());
+        segments.push_back (std::move (segment));
+    }
+
+    findContinuations();
+}
+
+void ClipTimeline::findContinuations()
+{
+    // allow one sample rounding error of the sample counts
+    const auto isClose = [](int64_t a, int64_t b) { return std::abs (a - b) <= 1; };
+
+    std::multimap<int64_t, size_t> ends;
+    for (size_t index = 0; index < clips.size(); ++index)
+        if (dynamic_cast<MovieClip*> (clips [index]->clip.get()) != nullptr)
+            ends.emplace (clips [index]->getStartInSamples() + clips [index]->getLengthInSamples(), index);
+
+    std::set<size_t> continued;
+    for (const auto& next : clips)
+    {
+        auto* nextClip = dynamic_cast<MovieClip*> (next->clip.get());
+        if (nextClip == nullptr)
+            continue;
+
+        const auto start = next->getStartInSamples();
+        for (auto it = ends.lower_bound (start - 1); it != ends.end() && it->first <= start + 1; ++it)
+        {
+            const auto& previous = clips [it->second];
+            auto* previousClip = dynamic_cast<MovieClip*> (previous->clip.get());
+
+            if (previous != next
+                && continued.count (it->second) == 0
+                && isClose (previous->getOffsetInSamples() + previous->getLengthInSamples(), next->getOffsetInSamples())
+                && nextClip->canContinue (*previousClip))
+            {
+                continued.insert (it->second);
+                continuations.emplace_back (next.get(), previous.get());
+                break;
+            }
+        }
+    }
+
+    std::sort (continuations.begin(), continuations.end());
+}
+
+ClipDescriptor* ClipTimeline::getContinuedClip (const ClipDescriptor* clip) const
+{
+    auto it = std::lower_bound (continuations.begin(), continuations.end(), clip,
+                                [](const auto& continuation, const ClipDescriptor* c) { return continuation.first < c; });
+
+    if (it != continuations.end() && it->first == clip)
+        return it->second;
+
+    return nullptr;
+}
+
+std::vector<ClipTimeline::Segment>::const_iterator ClipTimeline::findSegment (double time) const
+{
+    return std::upper_bound (segments.begin(), segments.end(), time,
+                             [](double t, const Segment& segment) { return t < segment.start; });
+}
+
+const ClipTimeline::ClipList& ClipTimeline::getClipsAt (double timeInSeconds) const
+{
+    auto it = findSegment (timeInSeconds);
+    if (it == segments.begin())
+        return noClips;
+
+    return std::prev (it)->clips;
+}
+
+const ClipTimeline::ClipList& ClipTimeline::getClipsInRange (double startTime, double endTime, RangeBuffer& buffer) const
+{
+    auto it = findSegment (startTime);
+    if (it == segments.end() || it->start >= endTime)
+        return it == segments.begin() ? noClips : std::prev (it)->clips;
+
+    auto& indices = buffer.indices;
+    indices.clear();
+
+    if (it != segments.begin())
+        indices.insert (indices.end(), std::prev (it)->indices.begin(), std::prev (it)->indices.end());
+
+    for (; it != segments.end() && it->start < endTime; ++it)
+        indices.insert (indices.end(), it->started.begin(), it->started.end());
+
+    std::sort (indices.begin(), indices.end());
+
+    buffer.clips.clear();
+    for (auto index : indices)
+        buffer.clips.push_back (clips [index]);
+
+    return buffer.clips;
+}
+
+bool ClipTimeline::hasVideo() const
+{
+    return anyVideo || std::any_of (nestedClips.begin(), nestedClips.end(), [](auto* nested) { return nested->hasVideo(); });
+}
+
+bool ClipTimeline::hasAudio() const
+{
+    return anyAudio || std::any_of (nestedClips.begin(), nestedClips.end(), [](auto* nested) { return nested->hasAudio(); });
+}
+
+} // foleys
@@ -0,0 +1,153 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+class ComposedClip;
+class AudioBus;
+
+/**
+ @class ClipTimeline
+
+ The ClipTimeline is an immutable index of the ClipDescriptors in a ComposedClip.
+ It sorts the start and end times of all clips into a table of segments, in which
+ the set of active clips doesn't change. That way the clips active at a certain
+ time can be found in O(log n) instead of testing every clip.
+
+ It also caches the total length and if any clip has video or audio, and it holds
+ the AudioBuses the clips are routed to.
+
+ The ComposedClip creates a new ClipTimeline each time the clips or their positions
+ change and publishes it in an AtomicSnapshot.
+ */
+class ClipTimeline final
+{
+public:
+    using ClipList = std::vector<std::shared_ptr<ClipDescriptor>>;
+    using BusList  = std::vector<std::shared_ptr<AudioBus>>;
+
+    /** Scratch memory for getClipsInRange(), owned by the caller, so the timeline stays immutable */
+    struct RangeBuffer
+    {
+        ClipList            clips;
+        std::vector<size_t> indices;
+
+        /** Reserve for that many clips, so collecting them doesn't allocate */
+        void reserve (size_t numClips)
+        {
+            clips.reserve (numClips);
+            indices.reserve (numClips);
+        }
+    };
+
+    ClipTimeline() = default;
+
+    /** Creates the index from clips in z-order */
+    ClipTimeline (ClipList clipsToUse, BusList busesToUse = {});
+
+    /** Returns all clips in z-order */
+    const ClipList& getClips() const { return clips; }
+
+    /** Returns the AudioBuses. ClipDescriptor::getAudioBusIndex() refers to this list */
+    const BusList& getBuses() const { return buses; }
+
+    /** Returns the clips active at the time in seconds in z-order */
+    const ClipList& getClipsAt (double timeInSeconds) const;
+
+    /**
+     Returns the clips in z-order, that are active at any time in the range. If the range lies
+     within one segment, this is the same list as getClipsAt(), otherwise the clips are collected
+     into the supplied buffer. The result is valid until the buffer is used again.
+     */
+    const ClipList& getClipsInRange (double startTime, double endTime, RangeBuffer& buffer) const;
+
+    /** The number of clips a RangeBuffer needs to be reserved for, so getClipsInRange() never allocates */
+    size_t getRangeCapacity() const { return clips.size(); }
+
+    /** Calls the function for each clip active in the range exactly once */
+    template<typename FunctionType>
+    void forEachClipInRange (double startTime, double endTime, FunctionType&& function) const
+    {
+        auto it = findSegment (startTime);
+        if (it != segments.begin())
+            for (const auto& clip : std::prev (it)->clips)
+                function (clip);
+
+        for (; it != segments.end() && it->start < endTime; ++it)
+            for (auto index : it->started)
+                function (clips [index]);
+    }
+
+    /** The end of the last clip in samples */
+    int64_t getTotalLength() const { return totalLength; }
+
+    /** The end of the last clip in seconds */
+    double getLengthInSeconds() const { return lengthInSeconds; }
+
+    bool hasVideo() const;
+    bool hasAudio() const;
+
+    /** Returns the maximum number of clips, that are active at the same time */
+    size_t getMaximumOverlap() const { return maximumOverlap; }
+
+    /**
+     Returns the clip, that ends where this clip starts and plays the same media continuously,
+     e.g. after splitting a clip. The decoder can be handed over at that cut instead of seeking.
+     Returns nullptr if there is no such clip.
+     */
+    ClipDescriptor* getContinuedClip (const ClipDescriptor* clip) const;
+
+private:
+    struct Segment
+    {
+        double              start = 0.0;
+        ClipList            clips;
+        std::vector<size_t> indices;
+        std::vector<size_t> started;
+    };
+
+    std::vector<Segment>::const_iterator findSegment (double time) const;
+
+    void findContinuations();
+
+    ClipList             clips;
+    BusList              buses;
+    std::vector<Segment> segments;
+    const ClipList       noClips;
+
+    int64_t              totalLength = 0;
+    double               lengthInSeconds = 0.0;
+    size_t               maximumOverlap = 0;
+    bool                 anyVideo = false;
+    bool                 anyAudio = false;
+
+    /** nested ComposedClips can change their streams, so these are asked each time */
+    std::vector<ComposedClip*> nestedClips;
+
+    /** pairs of continuing and continued clip, sorted by the continuing clip */
+    std::vector<std::pair<const ClipDescriptor*, ClipDescriptor*>> continuations;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClipTimeline)
+};
+
+} // foleys
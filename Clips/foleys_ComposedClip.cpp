@@ -37,6 +37,11 @@ namespace IDs
     static juce::Identifier state        { "state" };
     static juce::Identifier audioProcessors { "AudioProcessors" };
     static juce::Identifier videoProcessors { "VideoProcessors" };
+    static juce::Identifier audioBuses   { "AudioBuses" };
+    static juce::Identifier audioBus     { "AudioBus" };
+    static juce::Identifier bus          { "bus" };
+    static juce::Identifier stem         { "stem" };
+    static juce::Identifier stems        { "stems" };
 }
 
 ComposedClip::ComposedClip (VideoEngine& engine)
@@ -47,12 +52,19 @@ ComposedClip::ComposedClip (VideoEngine& engine)
     videoSettings.frameSize = {1280, 720};
     videoSettings.timebase = 24000;
     videoSettings.defaultDuration = 1001;
+    composedFrames.setVideoSettings (videoSettings);
 
-    audioMixer = std::make_unique<DefaultAudioMixer>();
+    audioMixer = std::make_unique<DefaultAudioMixer> (&engine.getAudioWorkerPool());
+    prepareAudioClipsBuffer (0);
 
     state.addListener (this);
 }
 
+ComposedClip::~ComposedClip()
+{
+    cancelRenderToCache();
+}
+
 juce::String ComposedClip::getDescription() const
 {
     return "Edit";
@@ -65,6 +77,15 @@ double ComposedClip::getFrameDurationInSeconds() const
 
 void ComposedClip::invalidateVideo()
 {
+    if (isInBatchEdit())
+    {
+        pendingInvalidate = true;
+        return;
+    }
+
+    resetDiscardedVideo();
+    resetComposition = true;
+
     lastShownFrame = -1;
     triggerAsyncUpdate();
     handleUpdateNowIfNeeded();
@@ -82,8 +103,10 @@ std::shared_ptr<ClipDescriptor> ComposedClip::addClip (std::shared_ptr<AVClip> c
 
     clipDescriptor->updateSampleCounts();
 
+    const auto stateIndex = juce::isPositiveAndBelow (zPosition, clips.size()) ? state.indexOf (clips [size_t (zPosition)]->getStatusTree()) : -1;
+
     juce::ScopedValueSetter<bool> manual (manualStateChange, true);
-    state.addChild (clipDescriptor->getStatusTree(), zPosition, getUndoManager());
+    state.addChild (clipDescriptor->getStatusTree(), stateIndex, getUndoManager());
 
     clipDescriptor->getVideoParameterController().addListener (this);
 
@@ -93,6 +116,8 @@ std::shared_ptr<ClipDescriptor> ComposedClip::addClip (std::shared_ptr<AVClip> c
             clips.insert (std::next (clips.begin(), zPosition), clipDescriptor);
         else
             clips.push_back (clipDescriptor);
+
+        publishClips();
     }
 
     return clipDescriptor;
@@ -102,10 +127,17 @@ void ComposedClip::removeClip (std::shared_ptr<ClipDescriptor> descriptor)
 {
     descriptor->getVideoParameterController().removeListener (this);
 
-    auto it = std::find (clips.begin(), clips.end(), descriptor);
-    if (it != clips.end())
-        clips.erase (it);
+    {
+        juce::ScopedLock sl (clipDescriptorLock);
+        auto it = std::find (clips.begin(), clips.end(), descriptor);
+        if (it != clips.end())
+        {
+            clips.erase (it);
+            publishClips();
+        }
+    }
 
+    juce::ScopedValueSetter<bool> manual (manualStateChange, true);
     state.removeChild (descriptor->getStatusTree(), getUndoManager());
 }
 
@@ -117,14 +149,135 @@ std::shared_ptr<ClipDescriptor> ComposedClip::getClip (int index)
     return {};
 }
 
+std::shared_ptr<AudioBus> ComposedClip::addAudioBus (const juce::String& name, int index)
+{
+    juce::ValueTree busState { IDs::audioBus, {{ IDs::name, name }} };
+    auto bus = std::make_shared<AudioBus> (*this, busState, getUndoManager());
+    bus->prepareToPlay (audioSettings.numChannels, audioSettings.timebase, audioSettings.defaultNumSamples);
+
+    {
+        juce::ScopedValueSetter<bool> manual (manualStateChange, true);
+        auto busesNode = state.getOrCreateChildWithName (IDs::audioBuses, getUndoManager());
+        busesNode.addChild (busState, index, getUndoManager());
+    }
+
+    juce::ScopedLock sl (clipDescriptorLock);
+    if (juce::isPositiveAndBelow (index, buses.size()))
+        buses.insert (std::next (buses.begin(), index), bus);
+    else
+        buses.push_back (bus);
+
+    publishClips();
+
+    return bus;
+}
+
+void ComposedClip::removeAudioBus (std::shared_ptr<AudioBus> bus)
+{
+    {
+        juce::ScopedLock sl (clipDescriptorLock);
+        auto it = std::find (buses.begin(), buses.end(), bus);
+        if (it != buses.end())
+        {
+            buses.erase (it);
+            publishClips();
+        }
+    }
+
+    juce::ScopedValueSetter<bool> manual (manualStateChange, true);
+    auto busesNode = state.getChildWithName (IDs::audioBuses);
+    busesNode.removeChild (bus->getStatusTree(), getUndoManager());
+}
+
+ComposedClip::BusList ComposedClip::getAudioBuses() const
+{
+    // during a batch edit the timeline is not published yet
+    if (isInBatchEdit())
+    {
+        juce::ScopedLock sl (clipDescriptorLock);
+        return buses;
+    }
+
+    auto snapshot = timeline.read();
+    return snapshot->getBuses();
+}
+
+std::shared_ptr<AudioBus> ComposedClip::getAudioBus (const juce::String& name) const
+{
+    for (const auto& bus : getAudioBuses())
+        if (bus->getName() == name)
+            return bus;
+
+    return {};
+}
+
+void ComposedClip::setAudioStems (const juce::StringArray& names)
+{
+    state.setProperty (IDs::stems, names.joinIntoString ("\n"), getUndoManager());
+}
+
+juce::StringArray ComposedClip::getAudioStems() const
+{
+    return juce::StringArray::fromLines (state.getProperty (IDs::stems).toString());
+}
+
+void ComposedClip::addAudioBusFromState (const juce::ValueTree& busState, int index)
+{
+    auto bus = std::make_shared<AudioBus> (*this, busState, getUndoManager());
+    bus->prepareToPlay (audioSettings.numChannels, audioSettings.timebase, audioSettings.defaultNumSamples);
+
+    juce::ScopedLock sl (clipDescriptorLock);
+    if (juce::isPositiveAndBelow (index, buses.size()))
+        buses.insert (std::next (buses.begin(), index), bus);
+    else
+        buses.push_back (bus);
+
+    publishClips();
+}
+
+void ComposedClip::removeAudioBusWithState (const juce::ValueTree& busState)
+{
+    juce::ScopedLock sl (clipDescriptorLock);
+    auto it = std::find_if (buses.begin(), buses.end(), [&busState](const auto& bus) { return bus->getStatusTree() == busState; });
+    if (it != buses.end())
+    {
+        buses.erase (it);
+        publishClips();
+    }
+}
+
 bool ComposedClip::isFrameAvailable (double pts) const
 {
-    juce::ignoreUnused (pts);
-    auto active = getClips();
-    auto pos = pts * getSampleRate();
+    return isComposedFrameAvailable (pts) || isSourceFrameAvailable (pts);
+}
+
+bool ComposedClip::isComposedFrameAvailable (double pts) const
+{
+    const juce::ScopedLock sl (composedFramesLock);
+
+    // after an edit the composed frames are outdated, until the job cleared them
+    return ! resetComposition && composedFrames.isFrameAvailable (pts);
+}
+
+bool ComposedClip::getComposedFrame (double pts, VideoFrame& target)
+{
+    const juce::ScopedLock sl (composedFramesLock);
+
+    if (resetComposition || ! composedFrames.isFrameAvailable (pts))
+        return false;
+
+    const auto& composed = composedFrames.getFrameSeconds (pts);
+    target.image = composed.image;
+    target.timecode = composed.timecode;
+    return true;
+}
+
+bool ComposedClip::isSourceFrameAvailable (double pts) const
+{
+    auto snapshot = timeline.read();
 
-    for (auto& clip : active)
-        if (clip->clip->hasVideo() && juce::isPositiveAndBelow (pos - clip->getStartInSamples(), clip->getLengthInSamples()))
+    for (const auto& clip : snapshot->getClipsAt (pts))
+        if (clip->clip->hasVideo())
             if (clip->clip->isFrameAvailable (pts - clip->getStart() + clip->getOffset()) == false)
                 return false;
 
@@ -133,21 +286,223 @@ bool ComposedClip::isFrameAvailable (double pts) const
 
 VideoFrame& ComposedClip::getFrame (double pts)
 {
-    auto nextTimeCode = convertTimecode (pts, videoSettings);
+    lastFrameRequest = juce::Time::getMillisecondCounter();
+
+    if (getComposedFrame (pts, frame))
+        return frame;
+
+    compositeFrame (frame, pts, layers);
+    return frame;
+}
+
+void ComposedClip::compositeFrame (VideoFrame& target, double pts, Compositor::LayerList& layersToUse, bool discardCoveredVideo)
+{
+    const auto timecode = convertTimecode (pts, videoSettings);
+    const auto area = juce::Rectangle<int> (videoSettings.frameSize.width, videoSettings.frameSize.height).toFloat();
+
+    // each frame is composited from the same time, no matter where in the frame pts is
+    const auto framePts = (double (timecode) + 0.5) / videoSettings.timebase;
 
-    if (frame.image.getWidth() != videoSettings.frameSize.width || frame.image.getHeight() != videoSettings.frameSize.height)
-        frame.image = juce::Image (juce::Image::ARGB, videoSettings.frameSize.width, videoSettings.frameSize.height, true);
+    auto snapshot = timeline.read();
+    std::vector<CoveredClip> covered;
+    const auto visible = getVisibleClips (*snapshot, framePts, area, 1.0f, discardCoveredVideo ? &covered : nullptr);
+
+    // the reader decodes ahead, so clips covered for a while skip decoding
+    for (const auto& clip : covered)
+        clip.descriptor->clip->discardVideoUntil (clip.discardUntil);
+
+    // the hash identifies the image without the time, so unchanged frames share one image
+    auto persistent = true;
+    const auto stateHash = getStateHash (visible, area, persistent);
+    const FrameCache::Key key { {}, 0, -1, videoSettings.frameSize.width, videoSettings.frameSize.height, stateHash };
+
+    auto* engine = getVideoEngine();
+    auto  cached = composedFrameCache.getFrame (key);
+
+    // frames pre-rendered by renderToCache() are read from disk
+    if (! cached.isValid() && persistent && engine != nullptr)
+    {
+        cached = engine->getRenderCache().getFrame (stateHash, videoSettings.frameSize);
+        if (cached.isValid())
+            composedFrameCache.addFrame (key, cached);
+    }
+
+    if (cached.isValid())
+    {
+        target.image = cached;
+        target.timecode = timecode;
+        return;
+    }
+
+    // while decoding catches up, e.g. after a seek, the clips return older frames. That composite is
+    // shown, but not cached under the hash of the requested frame
+    const auto sourcesReady = isSourceFrameAvailable (framePts);
+
+    // an image still held elsewhere, e.g. by a view or the cache, must not be overwritten
+    if (target.image.getWidth() != videoSettings.frameSize.width || target.image.getHeight() != videoSettings.frameSize.height
+        || target.image.getReferenceCount() > 1)
+        target.image = juce::Image (juce::Image::ARGB, videoSettings.frameSize.width, videoSettings.frameSize.height, true);
     else
-        frame.image.clear (frame.image.getBounds());
+        target.image.clear (target.image.getBounds());
 
-    auto active = getClips();
+    // nested edits add their clips, so the whole frame is composited in one parallel pass
+    {
+        const juce::ScopedLock sl (compositingLock);
+        layersToUse.clear();
+        addLayersOfClips (layersToUse, visible, area, 1.0f);
+    }
 
-    juce::Graphics g (frame.image);
+    Compositor::drawLayers (target.image, layersToUse, engine != nullptr ? &engine->getVideoWorkerPool() : nullptr);
+    layersToUse.clear();
 
-    render (g, frame.image.getBounds().toFloat(), pts, 0.0, 100.0, juce::Point<float>(), 1.0);
+    if (sourcesReady)
+        composedFrameCache.addFrame (key, target.image);
 
-    frame.timecode = nextTimeCode;
-    return frame;
+    target.timecode = timecode;
+}
+
+juce::uint64 ComposedClip::getStateHash (const std::vector<VisibleClip>& visible, juce::Rectangle<float> area, bool& persistent)
+{
+    auto hash = juce::uint64 (0xcbf29ce484222325);
+
+    const auto combine = [&hash](juce::uint64 value)
+    {
+        hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    };
+
+    const auto combineDouble = [&combine](double value)
+    {
+        juce::uint64 bits;
+        std::memcpy (&bits, &value, sizeof (bits));
+        combine (bits);
+    };
+
+    // the clips in z-order with all values, that change what they contribute to the frame. Only values
+    // restored with the edit are used, so the hashes of the RenderCache are valid in the next session
+    // The time itself is only used, if the image of a clip or a processor depends on it. That
+    // way a still image or an unautomated layer results in the same hash for all its frames.
+    for (const auto& clip : visible)
+    {
+        combine (clip.descriptor->getVideoStateHash());
+
+        for (const auto& parameter : clip.descriptor->getVideoParameterController().getParameters())
+            combineDouble (parameter.second->getValueForTime (clip.localPts));
+
+        auto timeDependent = false;
+        for (const auto& controller : clip.descriptor->getVideoProcessors())
+        {
+            if (! controller->isActive())
+                continue;
+
+            if (auto* processor = controller->getVideoProcessor())
+                timeDependent = timeDependent || processor->isTimeDependent();
+
+            for (const auto& parameter : controller->getParameters())
+                combineDouble (parameter.second->getValueForTime (clip.localPts));
+        }
+
+        if (timeDependent)
+            combineDouble (clip.localPts);
+
+        if (auto* nested = dynamic_cast<ComposedClip*> (clip.descriptor->clip.get()))
+        {
+            auto nestedSnapshot = nested->timeline.read();
+            combine (nested->getStateHash (nested->getVisibleClips (*nestedSnapshot, clip.localPts, area, 1.0f), area, persistent));
+            continue;
+        }
+
+        // the same name might refer to a replaced file in the next session
+        const auto url = clip.descriptor->clip->getMediaFile();
+        const auto file = url.isLocalFile() ? url.getLocalFile() : juce::File();
+        if (file.existsAsFile())
+        {
+            combine (juce::uint64 (url.toString (true).hashCode64()));
+            combine (juce::uint64 (file.getSize()));
+            combine (juce::uint64 (file.getLastModificationTime().toMilliseconds()));
+        }
+        else
+        {
+            combine (juce::uint64 (reinterpret_cast<juce::pointer_sized_uint> (clip.descriptor->clip.get())));
+            persistent = false;
+        }
+
+        const auto frameIdentifier = clip.descriptor->clip->getFrameIdentifier (clip.localPts);
+        if (frameIdentifier < 0)
+            combineDouble (clip.localPts);
+        else
+            combine (juce::uint64 (frameIdentifier));
+    }
+
+    return hash;
+}
+
+bool ComposedClip::getRenderCacheHash (double pts, juce::uint64& stateHash)
+{
+    const auto timecode = convertTimecode (pts, videoSettings);
+    const auto area = juce::Rectangle<int> (videoSettings.frameSize.width, videoSettings.frameSize.height).toFloat();
+    const auto framePts = (double (timecode) + 0.5) / videoSettings.timebase;
+
+    auto snapshot = timeline.read();
+    auto persistent = true;
+    stateHash = getStateHash (getVisibleClips (*snapshot, framePts, area, 1.0f), area, persistent);
+    return persistent;
+}
+
+juce::int64 ComposedClip::getFrameIdentifier (double pts)
+{
+    juce::uint64 stateHash = 0;
+    getRenderCacheHash (pts, stateHash);
+
+    // the identifier must not be negative
+    return juce::int64 (stateHash >> 1);
+}
+
+FrameCache& ComposedClip::getComposedFrameCache()
+{
+    return composedFrameCache;
+}
+
+bool ComposedClip::renderToCache (double startTime, double endTime)
+{
+    auto* engine = getVideoEngine();
+    if (engine == nullptr || ! engine->getRenderCache().isEnabled() || endTime <= startTime)
+        return false;
+
+    cancelRenderToCache();
+
+    auto copy = std::dynamic_pointer_cast<ComposedClip> (createCopy (StreamTypes::all()));
+    if (copy == nullptr)
+        return false;
+
+    // the copy must not take the audio WorkerPool from the live playback
+    copy->useSerialAudioMixer();
+    copy->prepareToPlay (audioSettings.defaultNumSamples, audioSettings.timebase);
+
+    cacheRenderJob = std::make_unique<CacheRenderJob> (copy, startTime, endTime);
+    engine->getThreadPool().addJob (cacheRenderJob.get(), false);
+    return true;
+}
+
+void ComposedClip::cancelRenderToCache()
+{
+    if (cacheRenderJob == nullptr)
+        return;
+
+    if (auto* engine = getVideoEngine())
+        engine->getThreadPool().removeJob (cacheRenderJob.get(), true, 5000);
+
+    cacheRenderJob.reset();
+}
+
+bool ComposedClip::isRenderingToCache() const
+{
+    auto* engine = getVideoEngine();
+    return cacheRenderJob != nullptr && engine != nullptr && engine->getThreadPool().contains (cacheRenderJob.get());
+}
+
+double ComposedClip::getRenderToCacheProgress() const
+{
+    return cacheRenderJob != nullptr ? cacheRenderJob->progress.load() : 0.0;
 }
 
 Size ComposedClip::getVideoSize() const
@@ -166,48 +521,239 @@ juce::Image ComposedClip::getStillImage ([[maybe_unused]]double seconds, [[maybe
     return {};
 }
 
-void ComposedClip::render (juce::Graphics& view, juce::Rectangle<float> area, double pts, float, float, juce::Point<float>, float alphaExtern)
+void ComposedClip::render (juce::Graphics& view, juce::Rectangle<float> area, double pts, float rotation, float zoom, juce::Point<float> translation, float alphaExtern)
 {
-    auto active = getClips();
+    lastFrameRequest = juce::Time::getMillisecondCounter();
+
+    if (getComposedFrame (pts, lastComposedFrame))
+    {
+        renderFrame (view, area, lastComposedFrame, rotation, zoom, translation, alphaExtern);
+        return;
+    }
 
-    for (auto clip : active)
+    // while playing, keep showing the last frame instead of compositing on the calling thread
+    if (isPlaying() && lastComposedFrame.image.isValid())
     {
-        if (! juce::isPositiveAndBelow (pts - clip->getStart(), clip->getLength()))
+        renderFrame (view, area, lastComposedFrame, rotation, zoom, translation, alphaExtern);
+        return;
+    }
+
+    const auto placement = getFrameTransform (area, rotation, zoom, translation);
+    const auto size = getPlacedSize (placement);
+
+    auto image = getComposedImage (pts, size);
+    if (! image.isValid())
+        return;
+
+    juce::Graphics::ScopedSaveState saveState (view);
+    view.setOpacity (alphaExtern);
+    view.drawImageTransformed (image, getPlacedImageTransform (size, placement));
+}
+
+void ComposedClip::addLayers (Compositor::LayerList& layersToAdd, juce::Rectangle<float> area, double pts, float rotation, float zoom, juce::Point<float> translation, float alphaExtern)
+{
+    if (alphaExtern <= 0.0f)
+        return;
+
+    // a nested edit is composited once at the size it is drawn and added as one layer
+    const auto placement = getFrameTransform (area, rotation, zoom, translation);
+    const auto size = getPlacedSize (placement);
+
+    auto image = getComposedImage (pts, size);
+    if (! image.isValid())
+        return;
+
+    layersToAdd.push_back ({ image, getPlacedImageTransform (size, placement), alphaExtern, Compositor::Sampling::bilinear, false });
+}
+
+juce::Image ComposedClip::getComposedImage (double pts, Size size)
+{
+    auto* engine = getVideoEngine();
+    if (engine == nullptr || size.width <= 0 || size.height <= 0)
+        return {};
+
+    // each frame is composited from the same time, no matter where in the frame pts is
+    const auto framePts = (double (convertTimecode (pts, videoSettings)) + 0.5) / videoSettings.timebase;
+    const auto area = juce::Rectangle<int> (size.width, size.height).toFloat();
+
+    auto snapshot = timeline.read();
+    const auto visible = getVisibleClips (*snapshot, framePts, area, 1.0f);
+
+    // the state hash identifies the image, so all instances and views of the same edit state share it
+    auto persistent = true;
+    const FrameCache::Key key { "ComposedClip", 0, -1, size.width, size.height, getStateHash (visible, area, persistent) };
+
+    auto& cache = engine->getFrameCache();
+    auto  image = cache.getFrame (key);
+    if (image.isValid())
+        return image;
+
+    // like compositeFrame(), a composite of older source frames is drawn, but not shared
+    const auto sourcesReady = isSourceFrameAvailable (framePts);
+
+    image = juce::Image (juce::Image::ARGB, size.width, size.height, true);
+
+    Compositor::LayerList nestedLayers;
+    {
+        const juce::ScopedLock sl (compositingLock);
+        addLayersOfClips (nestedLayers, visible, area, 1.0f);
+    }
+    Compositor::drawLayers (image, nestedLayers, &engine->getVideoWorkerPool());
+
+    if (sourcesReady)
+        cache.addFrame (key, image);
+
+    return image;
+}
+
+Size ComposedClip::getPlacedSize (const juce::AffineTransform& placement) const
+{
+    // more pixels than the frame size can't add any detail
+    const auto scaleX = std::min (1.0f, std::hypot (placement.mat00, placement.mat10));
+    const auto scaleY = std::min (1.0f, std::hypot (placement.mat01, placement.mat11));
+
+    return { std::max (1, int (std::ceil (videoSettings.frameSize.width  * scaleX))),
+             std::max (1, int (std::ceil (videoSettings.frameSize.height * scaleY))) };
+}
+
+juce::AffineTransform ComposedClip::getPlacedImageTransform (Size size, const juce::AffineTransform& placement) const
+{
+    return juce::AffineTransform::scale (float (videoSettings.frameSize.width)  / float (size.width),
+                                         float (videoSettings.frameSize.height) / float (size.height))
+                                 .followedBy (placement);
+}
+
+void ComposedClip::addLayersOfClips (Compositor::LayerList& layersToAdd, const std::vector<VisibleClip>& clipsToAdd,
+                                     juce::Rectangle<float> area, float alphaExtern)
+{
+    for (const auto& visible : clipsToAdd)
+    {
+        const auto& transform = visible.transform;
+        const auto  alpha = transform.alpha * alphaExtern;
+        auto&       clip = *visible.descriptor->clip;
+
+        // clips like the MulticamClip read their parameters when adding their layers
+        visible.descriptor->updateVideoAutomations (visible.localPts);
+
+        if (! visible.descriptor->hasActiveVideoProcessors())
+        {
+            clip.addLayers (layersToAdd, area, visible.localPts, float (transform.rotation), float (transform.zoom),
+                            { float (transform.translateX), float (transform.translateY) }, alpha);
             continue;
+        }
 
-        auto localPts = clip->getClipTimeInDescriptorTime (pts);
-        clip->updateVideoAutomations (localPts);
+        auto image = visible.descriptor->getProcessedFrame (visible.localPts, videoSettings);
+        if (image.isNull() || alpha <= 0.0f)
+            continue;
 
-        const auto alpha    = float (clip->getVideoParameterController().getValueAtTime (IDs::alpha,  localPts, 1.0)) * alphaExtern;
-        const auto zoom     = clip->getVideoParameterController().getValueAtTime (IDs::zoom,   localPts, 1.0);
-        const auto transX   = clip->getVideoParameterController().getValueAtTime (IDs::translateX, localPts, 0.0);
-        const auto transY   = clip->getVideoParameterController().getValueAtTime (IDs::translateY, localPts, 0.0);
-        const auto rotation = clip->getVideoParameterController().getValueAtTime (IDs::rotation, localPts, 0.0);
+        // the processed frame is placed like the clip's frame. Processors might add transparency,
+        // so it never hides the clips below
+        const auto videoSize = clip.getVideoSize();
+        const auto placement = clip.getFrameTransform (area, float (transform.rotation), float (transform.zoom),
+                                                       { float (transform.translateX), float (transform.translateY) });
+        const auto scale = videoSize.width > 0 && videoSize.height > 0
+                         ? juce::AffineTransform::scale (float (videoSize.width) / float (image.getWidth()), float (videoSize.height) / float (image.getHeight()))
+                         : juce::AffineTransform();
 
-        clip->clip->render (view, area, localPts, float (rotation), float (zoom), { float (transX), float (transY) }, alpha);
+        layersToAdd.push_back ({ image, scale.followedBy (placement), alpha, Compositor::Sampling::bilinear, false });
     }
 }
 
+std::vector<ComposedClip::VisibleClip> ComposedClip::getVisibleClips (const ClipTimeline& snapshot, double pts,
+                                                                      juce::Rectangle<float> area, float alphaExtern,
+                                                                      std::vector<CoveredClip>* covered) const
+{
+    std::vector<VisibleClip> visible;
+
+    for (const auto& clip : snapshot.getClipsAt (pts))
+    {
+        if (! clip->getVideoVisible() || ! juce::isPositiveAndBelow (pts - clip->getStart(), clip->getLength()))
+            continue;
+
+        const auto localPts = clip->getClipTimeInDescriptorTime (pts);
+        visible.push_back ({ clip.get(), localPts, clip->getVideoTransformAt (localPts) });
+    }
+
+    struct Occluder
+    {
+        juce::Rectangle<int>  covered;
+        const ClipDescriptor* descriptor;
+        bool                  isStatic;
+    };
+
+    std::vector<Occluder> occluders;
+    std::vector<const ClipDescriptor*> occluded;
+    const auto frameBounds = area.getSmallestIntegerContainer();
+
+    // from the top down, a clip within the covered area of a clip above is not drawn
+    for (auto it = visible.rbegin(); it != visible.rend(); ++it)
+    {
+        const auto& descriptor = *it->descriptor;
+        const auto& transform  = it->transform;
+        const auto  size       = descriptor.clip->getVideoSize();
+        const auto  placement  = descriptor.clip->getFrameTransform (area, float (transform.rotation), float (transform.zoom),
+                                                                     { float (transform.translateX), float (transform.translateY) });
+        const auto  bounds     = Compositor::getLayerBounds (size, placement).getIntersection (frameBounds);
+
+        auto occluder = std::find_if (occluders.begin(), occluders.end(), [&bounds](const auto& o) { return o.covered.contains (bounds); });
+        if (occluder != occluders.end())
+        {
+            occluded.push_back (&descriptor);
+
+            // the reader decodes ahead, so it can only skip frames, if neither clip moves until the cover ends
+            if (covered != nullptr && occluder->isStatic)
+            {
+                const auto coverEnd = std::min (occluder->descriptor->getStart() + occluder->descriptor->getLength(),
+                                                descriptor.getStart() + descriptor.getLength());
+                const auto localEnd = descriptor.getClipTimeInDescriptorTime (coverEnd);
+
+                if (! descriptor.isVideoTransformChangingBetween (it->localPts, localEnd))
+                    covered->push_back ({ it->descriptor, localEnd });
+            }
+
+            continue;
+        }
+
+        // processors might add transparency, so only unprocessed clips hide the clips below
+        if (transform.alpha * alphaExtern >= 1.0f && descriptor.clip->isOpaque() && ! descriptor.hasActiveVideoProcessors())
+        {
+            const auto localEnd = descriptor.getClipTimeInDescriptorTime (descriptor.getStart() + descriptor.getLength());
+            occluders.push_back ({ Compositor::getCoveredBounds (size, placement), &descriptor,
+                                   ! descriptor.isVideoTransformChangingBetween (it->localPts, localEnd) });
+        }
+    }
+
+    if (! occluded.empty())
+        visible.erase (std::remove_if (visible.begin(), visible.end(), [&occluded](const auto& v)
+                                       { return std::find (occluded.begin(), occluded.end(), v.descriptor) != occluded.end(); }),
+                       visible.end());
+
+    return visible;
+}
+
+void ComposedClip::resetDiscardedVideo()
+{
+    for (const auto& descriptor : clips)
+        descriptor->clip->discardVideoUntil (0.0);
+}
+
 #if FOLEYS_USE_OPENGL
 void ComposedClip::render (OpenGLView& view, double pts, float, float, juce::Point<float>, float alphaExtern)
 {
-    auto active = getClips();
+    auto snapshot = timeline.read();
 
-    for (auto clip : active)
+    for (const auto& clip : snapshot->getClipsAt (pts))
     {
-        if (! juce::isPositiveAndBelow (pts - clip->getStart(), clip->getLength()))
+        if (! clip->getVideoVisible() || ! juce::isPositiveAndBelow (pts - clip->getStart(), clip->getLength()))
             continue;
 
         auto localPts = clip->getClipTimeInDescriptorTime (pts);
         clip->updateVideoAutomations (localPts);
 
-        const auto alpha    = float (clip->getVideoParameterController().getValueAtTime (IDs::alpha,  localPts, 1.0)) * alphaExtern;
-        const auto zoom     = clip->getVideoParameterController().getValueAtTime (IDs::zoom,   localPts, 1.0);
-        const auto transX   = clip->getVideoParameterController().getValueAtTime (IDs::translateX, localPts, 0.0);
-        const auto transY   = clip->getVideoParameterController().getValueAtTime (IDs::translateY, localPts, 0.0);
-        const auto rotation = clip->getVideoParameterController().getValueAtTime (IDs::rotation, localPts, 0.0);
+        const auto transform = clip->getVideoTransformAt (localPts);
 
-        clip->clip->render (view, localPts, float (rotation), float (zoom), { float (transX), float (transY) }, alpha);
+        clip->clip->render (view, localPts, float (transform.rotation), float (transform.zoom),
+                            { float (transform.translateX), float (transform.translateY) }, transform.alpha * alphaExtern);
     }
 }
 #endif
@@ -224,35 +770,70 @@ void ComposedClip::prepareToPlay (int samplesPerBlockExpected, double sampleRate
 
     audioMixer->setup (audioSettings.numChannels, audioSettings.timebase, audioSettings.defaultNumSamples);
 
-    for (auto& descriptor : getClips())
     {
-        descriptor->clip->prepareToPlay (audioSettings.defaultNumSamples, audioSettings.timebase);
-        descriptor->updateSampleCounts();
+        juce::ScopedLock sl (clipDescriptorLock);
+
+        for (const auto& descriptor : clips)
+        {
+            descriptor->clip->prepareToPlay (audioSettings.defaultNumSamples, audioSettings.timebase);
+            descriptor->updateSampleCounts();
+        }
+
+        for (const auto& bus : buses)
+            bus->prepareToPlay (audioSettings.numChannels, audioSettings.timebase, audioSettings.defaultNumSamples);
+
+        publishClips();
     }
 }
 
 void ComposedClip::releaseResources()
 {
-    for (auto& descriptor : getClips())
+    auto snapshot = timeline.read();
+    for (const auto& descriptor : snapshot->getClips())
         descriptor->clip->releaseResources();
+
+    for (const auto& bus : snapshot->getBuses())
+        bus->releaseResources();
 }
 
 void ComposedClip::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
+{
+    std::vector<juce::AudioBuffer<float>> noStems;
+    getNextAudioBlockWithStems (info, noStems);
+}
+
+void ComposedClip::getNextAudioBlockWithStems (const juce::AudioSourceChannelInfo& info,
+                                               std::vector<juce::AudioBuffer<float>>& stems)
 {
     info.clearActiveBufferRegion();
-    auto pos = position.load();
+    lastAudioBlock = juce::Time::getMillisecondCounter();
+
+    const auto pos = position.load();
+    const auto sampleRate = getSampleRate();
 
-    auto active = getClips();
-    active.erase (std::remove_if (active.begin(), active.end(),
-                                  [pos](auto& clip)
-                                  {
-        return ! clip->clip->hasAudio() || ! juce::isPositiveAndBelow (pos - clip->getStartInSamples(), clip->getLengthInSamples());
-    }), active.end());
+    if (sampleRate > 0)
+    {
+        auto snapshot = timeline.read();
 
-    audioMixer->mixAudio (info,
-                          position.load(),
-                          getCurrentTimeInSeconds(),
-                          active);
+        // one sample tolerance, the mixer checks the exact sample positions
+        const auto& active = snapshot->getClipsInRange ((pos - 1) / sampleRate, (pos + info.numSamples + 1) / sampleRate, acquireAudioClipsBuffer());
+
+        handOverDecoders (*snapshot, active, pos, info.numSamples);
+
+        if (stems.empty())
+            audioMixer->mixAudio (info,
+                                  pos,
+                                  getCurrentTimeInSeconds(),
+                                  active,
+                                  snapshot->getBuses());
+        else
+            audioMixer->mixAudioWithStems (info,
+                                           pos,
+                                           getCurrentTimeInSeconds(),
+                                           active,
+                                           snapshot->getBuses(),
+                                           stems);
+    }
 
     position.fetch_add (info.numSamples);
     triggerAsyncUpdate();
@@ -264,19 +845,22 @@ bool ComposedClip::waitForSamplesReady (int samples, int timeout)
     const auto start = juce::Time::getMillisecondCounter();
     const auto pos = position.load();
 
-    auto active = getClips();
-    active.erase (std::remove_if (active.begin(), active.end(),
-                                  [pos](auto& clip)
-                                  {
-        return ! clip->clip->hasAudio() || ! juce::isPositiveAndBelow (pos - clip->getStartInSamples(), clip->getLengthInSamples());
-    }), active.end());
+    const auto sampleRate = getSampleRate();
+
+    if (sampleRate <= 0)
+        return ready;
+
+    preRollClips (pos);
+
+    auto snapshot = timeline.read();
 
-    for (auto clip : active)
+    snapshot->forEachClipInRange (pos / sampleRate, (pos + samples) / sampleRate, [&](const auto& clip)
     {
+        if (! ready || ! clip->clip->hasAudio() || ! juce::isPositiveAndBelow (pos - clip->getStartInSamples(), clip->getLengthInSamples()))
+            return;
+
         ready &= clip->clip->waitForSamplesReady (samples, std::min (timeout, timeout + int (start - juce::Time::getMillisecondCounter())));
-        if (ready == false)
-            break;
-    }
+    });
 
     return ready;
 }
@@ -284,14 +868,88 @@ bool ComposedClip::waitForSamplesReady (int samples, int timeout)
 void ComposedClip::setNextReadPosition (juce::int64 samples)
 {
     position.store (samples);
-    for (auto& descriptor : getClips())
-        descriptor->clip->setNextReadPosition (std::max (juce::int64 (samples + descriptor->getOffsetInSamples() - descriptor->getStartInSamples()), juce::int64 (descriptor->getOffsetInSamples())));
+
+    {
+        // clips further away are seeked later by preRollClips()
+        auto snapshot = timeline.read();
+        for (const auto& descriptor : snapshot->getClips())
+            descriptor->preRolled = false;
+    }
+
+    preRollClips (samples);
+    resetComposition = true;
 
     lastShownFrame = 0;
 
     triggerAsyncUpdate();
 }
 
+void ComposedClip::preRollClips (int64_t pos)
+{
+    const auto sampleRate = getSampleRate();
+    if (sampleRate <= 0)
+        return;
+
+    auto snapshot = timeline.read();
+
+    const auto time = pos / sampleRate;
+    snapshot->forEachClipInRange (time, time + preRollTime.load(), [&snapshot, pos](const auto& descriptor)
+    {
+        // a clip continuing the previous media takes over its decoder in the block of the cut. It is
+        // only seeked after that block, if the handover didn't happen, e.g. because the previous clip
+        // was out of sync. A block ending at the cut hands over in the next block
+        if (snapshot->getContinuedClip (descriptor.get()) != nullptr
+            && (pos <= descriptor->getStartInSamples() || descriptor->isWaitingForDecoder()))
+            return;
+
+        if (descriptor->preRolled.exchange (true))
+            return;
+
+        descriptor->clip->setNextReadPosition (std::max (juce::int64 (pos + descriptor->getOffsetInSamples() - descriptor->getStartInSamples()),
+                                                         juce::int64 (descriptor->getOffsetInSamples())));
+    });
+}
+
+void ComposedClip::handOverDecoders (const ClipTimeline& snapshot, const ClipList& active, int64_t pos, int numSamples)
+{
+    for (const auto& next : active)
+    {
+        auto* previous = snapshot.getContinuedClip (next.get());
+        if (previous == nullptr)
+            continue;
+
+        next->decoderSource = nullptr;
+
+        auto* nextClip = dynamic_cast<MovieClip*> (next->clip.get());
+        auto* previousClip = dynamic_cast<MovieClip*> (previous->clip.get());
+        if (next->preRolled.load() || nextClip == nullptr || previousClip == nullptr)
+            continue;
+
+        const auto cut = next->getStartInSamples();
+        const auto inSync = previousClip->getNextReadPosition() == pos + previous->getOffsetInSamples() - previous->getStartInSamples();
+
+        // the mixer hands the decoder over after the previous clip rendered up to the cut,
+        // if the handover fails, the clip is left for preRollClips() to seek it
+        if (inSync && pos <= cut && cut < pos + numSamples)
+        {
+            next->decoderSource = previous;
+
+            if (! nextClip->hasAudio())
+                next->takeOverDecoder();
+        }
+    }
+}
+
+void ComposedClip::setPreRollTime (double seconds)
+{
+    preRollTime = std::max (0.0, seconds);
+}
+
+double ComposedClip::getPreRollTime() const
+{
+    return preRollTime.load();
+}
+
 juce::int64 ComposedClip::getNextReadPosition() const
 {
     return position;
@@ -299,11 +957,8 @@ juce::int64 ComposedClip::getNextReadPosition() const
 
 juce::int64 ComposedClip::getTotalLength() const
 {
-    int64_t length = 0;
-    for (auto& descriptor : getClips())
-        length = std::max (length, descriptor->getStartInSamples() + descriptor->getLengthInSamples());
-
-    return length;
+    auto snapshot = timeline.read();
+    return snapshot->getTotalLength();
 }
 
 bool ComposedClip::isLooping() const
@@ -318,20 +973,14 @@ void ComposedClip::setLooping (bool shouldLoop)
 
 bool ComposedClip::hasVideo() const
 {
-    bool hasVideo = false;
-    for (auto& descriptor : getClips())
-        hasVideo |= descriptor->clip->hasVideo();
-
-    return hasVideo;
+    auto snapshot = timeline.read();
+    return snapshot->hasVideo();
 }
 
 bool ComposedClip::hasAudio() const
 {
-    bool hasAudio = false;
-    for (auto& descriptor : clips)
-        hasAudio |= descriptor->clip->hasAudio();
-
-    return hasAudio;
+    auto snapshot = timeline.read();
+    return snapshot->hasAudio();
 }
 
 void ComposedClip::parameterAutomationChanged (const ParameterAutomation*)
@@ -348,12 +997,25 @@ std::shared_ptr<AVClip> ComposedClip::createCopy (StreamTypes)
     auto clipCopy = std::make_shared<ComposedClip>(*engine);
     engine->manageLifeTime (clipCopy);
 
+    // the root properties like the audio stems, before the clips and buses refer to them
+    clipCopy->getStatusTree().copyPropertiesFrom (getStatusTree(), nullptr);
+
     for (auto clip : getStatusTree())
         clipCopy->getStatusTree().appendChild (clip.createCopy(), nullptr);
 
     return clipCopy;
 }
 
+void ComposedClip::useSerialAudioMixer()
+{
+    audioMixer = std::make_unique<DefaultAudioMixer>();
+
+    juce::ScopedLock sl (clipDescriptorLock);
+    for (const auto& descriptor : clips)
+        if (auto* nested = dynamic_cast<ComposedClip*> (descriptor->clip.get()))
+            nested->useSerialAudioMixer();
+}
+
 double ComposedClip::getSampleRate() const
 {
     return audioSettings.timebase;
@@ -366,6 +1028,18 @@ int ComposedClip::getDefaultBufferSize() const
 
 void ComposedClip::handleAsyncUpdate()
 {
+    {
+        juce::ScopedLock sl (clipDescriptorLock);
+        timeline.releaseRetired();
+        prepareAudioClipsBuffer (audioClipsCapacity);
+
+        for (const auto& bus : buses)
+            bus->releaseRetiredProcessors();
+    }
+
+    // this is triggered after each audio block, so the clips are seeked ahead of their start
+    preRollClips (position.load());
+
     if (audioSettings.timebase > 0)
     {
         const auto v = hasVideo();
@@ -390,17 +1064,28 @@ double ComposedClip::convertToSeconds (int64_t pos) const
     return {};
 }
 
-void ComposedClip::valueTreePropertyChanged (juce::ValueTree&,
-                                             const juce::Identifier&)
+void ComposedClip::valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
+                                             const juce::Identifier& property)
 {
+    if (treeWhosePropertyHasChanged == state && property == IDs::stems)
+        publishClips();
 }
 
-void ComposedClip::valueTreeChildAdded (juce::ValueTree&, juce::ValueTree& childWhichHasBeenAdded)
+void ComposedClip::valueTreeChildAdded (juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenAdded)
 {
     if (manualStateChange)
         return;
 
-    if (childWhichHasBeenAdded.getType() == IDs::clip)
+    if (parentTree == state && childWhichHasBeenAdded.getType() == IDs::audioBuses)
+    {
+        for (const auto& busState : childWhichHasBeenAdded)
+            addAudioBusFromState (busState, -1);
+    }
+    else if (parentTree.getType() == IDs::audioBuses && childWhichHasBeenAdded.getType() == IDs::audioBus)
+    {
+        addAudioBusFromState (childWhichHasBeenAdded, parentTree.indexOf (childWhichHasBeenAdded));
+    }
+    else if (parentTree == state && childWhichHasBeenAdded.getType() == IDs::clip)
     {
         auto descriptor = std::make_shared<ClipDescriptor>(*this, childWhichHasBeenAdded, getUndoManager());
         if (descriptor->clip != nullptr)
@@ -409,23 +1094,34 @@ void ComposedClip::valueTreeChildAdded (juce::ValueTree&, juce::ValueTree& child
             descriptor->updateSampleCounts();
             descriptor->getVideoParameterController().addListener (this);
 
-            auto index = state.indexOf (childWhichHasBeenAdded);
+            auto index = getClipIndex (childWhichHasBeenAdded);
 
             juce::ScopedLock sl (clipDescriptorLock);
-            if (index >= 0)
+            if (juce::isPositiveAndBelow (index, clips.size()))
                 clips.insert (clips.begin() + index, descriptor);
             else
                 clips.push_back (descriptor);
+
+            publishClips();
         }
     }
 }
 
-void ComposedClip::valueTreeChildRemoved (juce::ValueTree&, juce::ValueTree& childWhichHasBeenRemoved, int)
+void ComposedClip::valueTreeChildRemoved (juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenRemoved, int)
 {
     if (manualStateChange)
         return;
 
-    if (childWhichHasBeenRemoved.getType() == IDs::clip)
+    if (parentTree == state && childWhichHasBeenRemoved.getType() == IDs::audioBuses)
+    {
+        for (const auto& busState : childWhichHasBeenRemoved)
+            removeAudioBusWithState (busState);
+    }
+    else if (parentTree.getType() == IDs::audioBuses && childWhichHasBeenRemoved.getType() == IDs::audioBus)
+    {
+        removeAudioBusWithState (childWhichHasBeenRemoved);
+    }
+    else if (parentTree == state && childWhichHasBeenRemoved.getType() == IDs::clip)
     {
         juce::ScopedLock sl (clipDescriptorLock);
         for (auto it = clips.begin(); it != clips.end(); ++it)
@@ -434,22 +1130,52 @@ void ComposedClip::valueTreeChildRemoved (juce::ValueTree&, juce::ValueTree& chi
             {
                 (*it)->getVideoParameterController().removeListener (this);
                 clips.erase (it);
+                publishClips();
                 return;
             }
         }
     }
 }
 
-void ComposedClip::valueTreeChildOrderChanged (juce::ValueTree&, int oldIndex, int newIndex)
+void ComposedClip::valueTreeChildOrderChanged (juce::ValueTree& parentTree, int, int)
 {
     if (manualStateChange)
         return;
 
-    juce::ScopedLock sl (clipDescriptorLock);
-    auto oldIt = clips.begin() + oldIndex;
-    auto element = *oldIt;
-    clips.erase (oldIt);
-    clips.insert (clips.begin() + newIndex, element);
+    // the indices refer to the state, which also contains the buses
+    if (parentTree == state)
+    {
+        juce::ScopedLock sl (clipDescriptorLock);
+        std::stable_sort (clips.begin(), clips.end(), [this](const auto& a, const auto& b)
+        {
+            return state.indexOf (a->getStatusTree()) < state.indexOf (b->getStatusTree());
+        });
+        publishClips();
+    }
+    else if (parentTree.getType() == IDs::audioBuses)
+    {
+        juce::ScopedLock sl (clipDescriptorLock);
+        std::stable_sort (buses.begin(), buses.end(), [&parentTree](const auto& a, const auto& b)
+        {
+            return parentTree.indexOf (a->getStatusTree()) < parentTree.indexOf (b->getStatusTree());
+        });
+        publishClips();
+    }
+}
+
+int ComposedClip::getClipIndex (const juce::ValueTree& clipState) const
+{
+    int index = 0;
+    for (const auto& child : state)
+    {
+        if (child == clipState)
+            return index;
+
+        if (child.getType() == IDs::clip)
+            ++index;
+    }
+
+    return -1;
 }
 
 juce::UndoManager* ComposedClip::getUndoManager()
@@ -470,12 +1196,148 @@ void ComposedClip::readPluginStatesIntoValueTree()
 {
     for (auto clip : getClips())
         clip->readPluginStatesIntoValueTree();
+
+    for (auto bus : getAudioBuses())
+        bus->readPluginStatesIntoValueTree();
+}
+
+ComposedClip::ClipList ComposedClip::getClips() const
+{
+    // during a batch edit the timeline is not published yet
+    if (isInBatchEdit())
+    {
+        juce::ScopedLock sl (clipDescriptorLock);
+        return clips;
+    }
+
+    auto snapshot = timeline.read();
+    return snapshot->getClips();
+}
+
+void ComposedClip::beginBatchEdit()
+{
+    ++batchEditDepth;
+}
+
+void ComposedClip::endBatchEdit()
+{
+    jassert (batchEditDepth > 0);
+    if (batchEditDepth > 1)
+    {
+        --batchEditDepth;
+        return;
+    }
+
+    // still deferring, so the reloaded automations only set the pending flags
+    for (const auto& descriptor : clips)
+    {
+        descriptor->getAudioParameterController().applyPendingUpdates();
+        descriptor->getVideoParameterController().applyPendingUpdates();
+
+        for (const auto& controller : descriptor->getAudioProcessors())
+            controller->applyPendingUpdates();
+
+        for (const auto& controller : descriptor->getVideoProcessors())
+            controller->applyPendingUpdates();
+    }
+
+    for (const auto& bus : buses)
+        for (const auto& controller : bus->getAudioProcessors())
+            controller->applyPendingUpdates();
+
+    batchEditDepth = 0;
+
+    if (std::exchange (pendingSampleCounts, false))
+        for (const auto& descriptor : clips)
+            descriptor->updateSampleCounts();
+
+    if (std::exchange (pendingPublish, false))
+        publishClips();
+
+    if (std::exchange (pendingInvalidate, false))
+        invalidateVideo();
 }
 
-std::vector<std::shared_ptr<ClipDescriptor>> ComposedClip::getClips() const
+bool ComposedClip::isInBatchEdit() const
 {
+    return batchEditDepth > 0;
+}
+
+void ComposedClip::publishClips()
+{
+    if (isInBatchEdit())
+    {
+        pendingPublish = true;
+        return;
+    }
+
     juce::ScopedLock sl (clipDescriptorLock);
-    return clips;
+
+    const auto stemNames = getAudioStems();
+    auto getStemIndex = [&stemNames](const juce::String& stemName)
+    {
+        return stemName.isEmpty() ? -1 : stemNames.indexOf (stemName);
+    };
+
+    for (const auto& descriptor : clips)
+    {
+        const auto busName = descriptor->getAudioBus();
+        auto bus = busName.isEmpty() ? buses.end()
+                                     : std::find_if (buses.begin(), buses.end(), [&busName](const auto& b) { return b->getName() == busName; });
+
+        descriptor->audioBusIndex  = bus != buses.end() ? int (std::distance (buses.begin(), bus)) : -1;
+        descriptor->audioStemIndex = getStemIndex (descriptor->getAudioStem());
+    }
+
+    for (const auto& bus : buses)
+        bus->audioStemIndex = getStemIndex (bus->getAudioStem());
+
+    auto snapshot = std::make_unique<ClipTimeline> (clips, buses);
+    prepareAudioClipsBuffer (snapshot->getRangeCapacity());
+
+    timeline.publish (std::move (snapshot));
+    resetDiscardedVideo();
+}
+
+void ComposedClip::prepareAudioClipsBuffer (size_t capacity)
+{
+    if (audioClipsBuffers.empty() || capacity > audioClipsCapacity)
+    {
+        auto buffer = std::make_unique<ClipTimeline::RangeBuffer>();
+        buffer->reserve (capacity);
+        audioClipsCapacity = capacity;
+
+        pendingAudioClipsBuffer.store (buffer.get());
+        audioClipsBuffers.push_back (std::move (buffer));
+    }
+
+    // a buffer the audio thread picked up is announced in activeAudioClipsBuffer before it is used
+    const auto* pending = pendingAudioClipsBuffer.load();
+    const auto* active  = activeAudioClipsBuffer.load();
+
+    audioClipsBuffers.erase (std::remove_if (audioClipsBuffers.begin(), audioClipsBuffers.end(),
+                                             [pending, active](const auto& buffer)
+                                             {
+                                                 return buffer.get() != pending && buffer.get() != active;
+                                             }),
+                             audioClipsBuffers.end());
+}
+
+ClipTimeline::RangeBuffer& ComposedClip::acquireAudioClipsBuffer()
+{
+    // announce the buffer before using it, and use it only if it is still the latest,
+    // otherwise the message thread might have freed it in between
+    auto* buffer = pendingAudioClipsBuffer.load();
+    for (;;)
+    {
+        activeAudioClipsBuffer.store (buffer);
+
+        auto* latest = pendingAudioClipsBuffer.load();
+        if (latest == buffer)
+            return *buffer;
+
+        buffer = latest;
+    }
 }
 
 juce::String ComposedClip::makeUniqueDescription (const juce::String& description) const
@@ -501,5 +1363,164 @@ juce::String ComposedClip::makeUniqueDescription (const juce::String& descriptio
     return description;
 }
 
+//==============================================================================
+
+ComposedClip::CompositionJob::CompositionJob (ComposedClip& ownerToUse)
+  : owner (ownerToUse)
+{
+}
+
+int ComposedClip::CompositionJob::useTimeSlice()
+{
+    auto& fifo = owner.composedFrames;
+    const auto& settings = owner.videoSettings;
+
+    {
+        // only this job resets the fifo. Readers check the flag under the same lock, so they never see old frames
+        const juce::ScopedLock sl (owner.composedFramesLock);
+        if (owner.resetComposition.exchange (false))
+        {
+            fifo.clear();
+            nextTimecode = -1;
+        }
+    }
+
+    // nobody fetched frames lately, e.g. a nested edit or an edit not shown
+    if (juce::Time::getMillisecondCounter() - owner.lastFrameRequest.load() > 1000 || owner.getSampleRate() <= 0 || ! owner.hasVideo())
+        return 30;
+
+    // the deadlines follow the audio clock
+    const auto playheadSeconds = owner.getCurrentTimeInSeconds();
+    const auto playhead = convertTimecode (playheadSeconds, settings);
+    const auto lookAhead = int64_t (fifo.getFreeSpace() + fifo.getNumAvailableFrames()) * settings.defaultDuration;
+
+    if (nextTimecode < 0 || nextTimecode > playhead + 2 * lookAhead || (owner.skipLateFrames && nextTimecode < playhead))
+        nextTimecode = playhead;
+
+    // frames the playhead passed without being fetched block the fifo
+    if (fifo.getFreeSpace() <= 2 && owner.skipLateFrames)
+    {
+        const juce::ScopedLock sl (owner.composedFramesLock);
+        fifo.setTimeCodeSeconds (playheadSeconds);
+    }
+
+    if (fifo.getFreeSpace() <= 2)
+        return 5;
+
+    const auto pts = double (nextTimecode) / settings.timebase;
+    if (! owner.isSourceFrameAvailable (pts))
+        return 5;
+
+    // composited outside the lock, the readers search the timecodes of the writing frame too
+    owner.compositeFrame (composed, pts, layers, true);
+
+    {
+        const juce::ScopedLock sl (owner.composedFramesLock);
+        auto& target = fifo.getWritingFrame();
+
+        // swapping hands the image of the overwritten frame back for reuse
+        std::swap (target.image, composed.image);
+        target.timecode = nextTimecode;
+        fifo.finishWriting();
+    }
+
+    nextTimecode += settings.defaultDuration;
+    return 0;
+}
+
+//==============================================================================
+
+ComposedClip::CacheRenderJob::CacheRenderJob (std::shared_ptr<ComposedClip> clipToRender, double startTimeToUse, double endTimeToUse)
+  : juce::ThreadPoolJob ("Render Cache Job"),
+    clip (clipToRender),
+    startTime (startTimeToUse),
+    endTime (endTimeToUse)
+{
+}
+
+juce::ThreadPoolJob::JobStatus ComposedClip::CacheRenderJob::runJob()
+{
+    auto* engine = clip->getVideoEngine();
+    if (engine == nullptr || ! clip->hasVideo() || clip->getSampleRate() <= 0)
+        return juce::ThreadPoolJob::jobHasFinished;
+
+    auto&       renderCache = engine->getRenderCache();
+    const auto& settings    = clip->videoSettings;
+    const auto  blockSize   = clip->getDefaultBufferSize();
+
+    // the frames go to disk, keeping them in memory as well would only push out the frames of the edit
+    clip->composedFrameCache.setMaximumSize (0);
+
+    buffer.setSize (clip->audioSettings.numChannels, blockSize);
+    clip->setNextReadPosition (convertTimecode (startTime, clip->audioSettings));
+
+    const auto startTimecode = convertTimecode (startTime, settings);
+    const auto endTimecode   = std::max (convertTimecode (endTime, settings), startTimecode + settings.defaultDuration);
+
+    for (auto timecode = startTimecode; timecode < endTimecode; timecode += settings.defaultDuration)
+    {
+        const auto pts = double (timecode) / settings.timebase;
+
+        // the audio is pulled like in playback, that moves the playhead and seeks the upcoming clips
+        while (clip->getCurrentTimeInSeconds() < pts)
+        {
+            if (shouldExit())
+                return juce::ThreadPoolJob::jobHasFinished;
+
+            juce::AudioSourceChannelInfo info (&buffer, 0, blockSize);
+            clip->waitForSamplesReady (blockSize);
+            clip->getNextAudioBlock (info);
+        }
+
+        juce::uint64 stateHash = 0;
+        if (clip->getRenderCacheHash (pts, stateHash) && ! renderCache.containsFrame (stateHash, settings.frameSize))
+        {
+            // a clip, that never delivers the frame, e.g. because it failed to decode, only costs that frame
+            const auto waitStart = juce::Time::getMillisecondCounter();
+            auto sourcesReady = clip->isSourceFrameAvailable (pts);
+
+            while (! sourcesReady && juce::Time::getMillisecondCounter() - waitStart < sourceFrameTimeout)
+            {
+                if (shouldExit())
+                    return juce::ThreadPoolJob::jobHasFinished;
+
+                juce::Thread::sleep (5);
+                sourcesReady = clip->isSourceFrameAvailable (pts);
+            }
+
+            if (sourcesReady)
+            {
+                clip->compositeFrame (frame, pts, layers, true);
+                renderCache.addFrame (stateHash, frame.image);
+            }
+        }
+
+        progress.store (double (timecode + settings.defaultDuration - startTimecode) / double (endTimecode - startTimecode));
+    }
+
+    // let the readers of the copy go
+    clip->releaseResources();
+    return juce::ThreadPoolJob::jobHasFinished;
+}
+
+juce::TimeSliceClient* ComposedClip::getBackgroundJob()
+{
+    return &compositionJob;
+}
+
+void ComposedClip::setSkipLateFrames (bool shouldSkip)
+{
+    skipLateFrames = shouldSkip;
+}
+
+bool ComposedClip::getSkipLateFrames() const
+{
+    return skipLateFrames;
+}
+
+bool ComposedClip::isPlaying() const
+{
+    return juce::Time::getMillisecondCounter() - lastAudioBlock.load() < 200;
+}
 
 } // foleys
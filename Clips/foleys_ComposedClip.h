@@ -51,6 +51,7 @@ public:
     };
 
     ComposedClip (VideoEngine& videoEngine);
+    ~ComposedClip() override;
 
     /** Used to identify the clip type to the user */
     juce::String getClipType() const override { return NEEDS_TRANS ("Edit"); }
@@ -61,8 +62,16 @@ public:
     juce::String getDescription() const override;
 
     VideoFrame& getFrame (double pts) override;
+
+    void addLayers (Compositor::LayerList& layers, juce::Rectangle<float> area, double pts, float rotation = 0.0f, float zoom = 100.0f, juce::Point<float> translation = juce::Point<float>(), float alpha = 1.0f) override;
     bool isFrameAvailable (double pts) const override;
 
+    /**
+     Returns the state hash of the frame. Frames, where the images and parameters of all visible
+     clips are the same, return the same identifier, e.g. a section of still images.
+     */
+    juce::int64 getFrameIdentifier (double pts) override;
+
     void render (juce::Graphics& view, juce::Rectangle<float> area, double pts, float rotation = 0.0f, float zoom = 100.0f, juce::Point<float> translation = juce::Point<float>(), float alpha = 1.0f) override;
 
 #if FOLEYS_USE_OPENGL
@@ -80,8 +89,30 @@ public:
     void releaseResources() override;
 
     void getNextAudioBlock (const juce::AudioSourceChannelInfo&) override;
+
+    /**
+     Renders the next block like getNextAudioBlock() and in the same pass writes the audio
+     assigned to each stem into the stems. That way each source is only read once.
+     Audio, that is not assigned to a stem, is only present in the master.
+     @param info receives the master mix
+     @param stems one buffer for each name in getAudioStems(), with at least info.numSamples
+                  samples. The stem audio starts at sample 0.
+     */
+    void getNextAudioBlockWithStems (const juce::AudioSourceChannelInfo& info,
+                                     std::vector<juce::AudioBuffer<float>>& stems);
+    /**
+     Sets the playhead. Only the clips active within the pre-roll time from the new position
+     are seeked, the others are seeked while the playhead approaches them.
+     */
     void setNextReadPosition (juce::int64 samples) override;
     juce::int64 getNextReadPosition() const override;
+
+    /**
+     Set the time in seconds, that upcoming clips are seeked before their start, so they
+     have time to fill their buffers. Default is 2 seconds.
+     */
+    void setPreRollTime (double seconds);
+    double getPreRollTime() const;
     juce::int64 getTotalLength() const override;
     bool isLooping() const override;
     void setLooping (bool shouldLoop) override;
@@ -102,6 +133,46 @@ public:
 
     int getDefaultBufferSize() const;
 
+    /**
+     The ComposedClip composites the frames ahead of the playhead on a background thread, so
+     getFrame() and render() only fetch the ready frames. If a frame can't be composited before
+     the audio clock passes it, it is skipped rather than letting the video fall behind.
+     Disable skipping, if every frame has to be composited in the background.
+     */
+    void setSkipLateFrames (bool shouldSkip);
+    bool getSkipLateFrames() const;
+
+    juce::TimeSliceClient* getBackgroundJob() override;
+
+    /**
+     The composed frames are kept in this cache, so playing a section again or scrubbing
+     doesn't composite the frames again. The frames are identified by a hash of everything
+     visible in them, so an edit only misses the frames it actually changes, and frames
+     without any change to the previous one, e.g. of still images, reuse the previous frame. Use
+     setMaximumSize() to adjust the memory (default 256 MB), 0 disables the cache.
+     */
+    FrameCache& getComposedFrameCache();
+
+    /**
+     Pre-renders the frames between startTime and endTime in the background into the RenderCache
+     of the VideoEngine. This is meant for sections too heavy to composite in realtime. While the
+     edit still matches the state a frame was rendered from, the frame is read from the cache
+     instead of being composited. Frames already in the cache are skipped, and frames showing
+     clips without a media file, e.g. generated images, can't be identified in a later session
+     and are not cached. The frames are rendered from a copy of this clip, so playback is not
+     disturbed. Call this from the message thread.
+     @returns false, if the RenderCache has no directory set
+     */
+    bool renderToCache (double startTime, double endTime);
+
+    /** Stops a running renderToCache(). The frames rendered so far stay in the cache. */
+    void cancelRenderToCache();
+
+    bool isRenderingToCache() const;
+
+    /** The progress of the running renderToCache() between 0.0 and 1.0 */
+    double getRenderToCacheProgress() const;
+
     /** Read all plugins getStateInformation() and save it into the statusTree as BLOB */
     void readPluginStatesIntoValueTree();
 
@@ -123,10 +194,68 @@ public:
      */
     void removeClip (std::shared_ptr<ClipDescriptor> descriptor);
 
+    using ClipList = ClipTimeline::ClipList;
+
     /** allows safe access to the clips list. It returns a copy you can modify at will */
-    std::vector<std::shared_ptr<ClipDescriptor>> getClips() const;
+    ClipList getClips() const;
     std::shared_ptr<ClipDescriptor> getClip (int index);
 
+    using BusList = ClipTimeline::BusList;
+
+    /**
+     Add an AudioBus to the ComposedClip. Clips are routed to the bus by calling
+     ClipDescriptor::setAudioBus() with the name of the bus.
+     @param name is the name of the bus, it should be unique within this ComposedClip
+     @param index is the position in the list of buses. -1 will add at the end.
+     @return the new bus, that can be used to add AudioProcessors
+     */
+    std::shared_ptr<AudioBus> addAudioBus (const juce::String& name, int index = -1);
+
+    /**
+     Remove an AudioBus. Clips routed to that bus will be played on the master.
+     */
+    void removeAudioBus (std::shared_ptr<AudioBus> bus);
+
+    /** allows safe access to the buses list. It returns a copy you can modify at will */
+    BusList getAudioBuses() const;
+
+    /** Returns the bus with that name or nullptr, if there is no such bus */
+    std::shared_ptr<AudioBus> getAudioBus (const juce::String& name) const;
+
+    /**
+     Set the names of the output stems, e.g. dialogue, music and effects. Clips and
+     AudioBuses are assigned to a stem using setAudioStem().
+     */
+    void setAudioStems (const juce::StringArray& names);
+    juce::StringArray getAudioStems() const;
+
+    /**
+     Start a batch edit. Until the matching endBatchEdit() the ComposedClip doesn't react
+     to each change individually: the clips are not published to the audio and video
+     threads, the video is not invalidated and automation is not reloaded. All that
+     happens once in endBatchEdit(). Batch edits can be nested.
+     Use this for scripted edits, that change many clips or keyframes at once.
+     */
+    void beginBatchEdit();
+
+    /** Finish a batch edit and apply all deferred updates at once */
+    void endBatchEdit();
+
+    /** Returns true, while a batch edit is in progress */
+    bool isInBatchEdit() const;
+
+    /** Calls beginBatchEdit() and endBatchEdit() when it goes out of scope */
+    class ScopedBatchEdit
+    {
+    public:
+        ScopedBatchEdit (ComposedClip& clipToEdit) : clip (clipToEdit) { clip.beginBatchEdit(); }
+        ~ScopedBatchEdit() { clip.endBatchEdit(); }
+
+    private:
+        ComposedClip& clip;
+        JUCE_DECLARE_NON_COPYABLE (ScopedBatchEdit)
+    };
+
     void valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
                                    const juce::Identifier& property) override;
 
@@ -156,22 +285,203 @@ private:
 
     double convertToSeconds (int64_t pos) const;
 
+    /** Publishes a new ClipTimeline of the clips vector for the audio and video threads.
+        Call this after each change of the clips vector or of a clip position */
+    void publishClips();
+
+    /** Mixes without the audio WorkerPool, also in nested edits. Call this before prepareToPlay() */
+    void useSerialAudioMixer();
+
+    void addAudioBusFromState (const juce::ValueTree& busState, int index);
+    void removeAudioBusWithState (const juce::ValueTree& busState);
+
+    /** Seeks the clips, that start within the pre-roll time and were not seeked yet */
+    void preRollClips (int64_t pos);
+
+    /** Hands the running decoder over at cuts between clips continuing the same media */
+    void handOverDecoders (const ClipTimeline& snapshot, const ClipList& active, int64_t pos, int numSamples);
+
+    /** Makes a RangeBuffer for that many clips available to the audio thread and frees unused ones */
+    void prepareAudioClipsBuffer (size_t capacity);
+
+    /** Returns the latest RangeBuffer, called on the audio thread at the start of a block */
+    ClipTimeline::RangeBuffer& acquireAudioClipsBuffer();
+
+    /** Composites the frames ahead of the playhead into composedFrames */
+    class CompositionJob : public juce::TimeSliceClient
+    {
+    public:
+        CompositionJob (ComposedClip& owner);
+
+        int useTimeSlice() override;
+
+    private:
+        ComposedClip&         owner;
+        Compositor::LayerList layers;
+        VideoFrame            composed;
+        int64_t               nextTimecode = -1;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompositionJob)
+    };
+
+    /** Renders a range of a copy of the ComposedClip into the RenderCache */
+    class CacheRenderJob : public juce::ThreadPoolJob
+    {
+    public:
+        CacheRenderJob (std::shared_ptr<ComposedClip> clipToRender, double startTime, double endTime);
+
+        juce::ThreadPoolJob::JobStatus runJob() override;
+
+        std::atomic<double> progress { 0.0 };
+
+        /** A frame is skipped, if the clips don't decode it within that time in milliseconds */
+        static constexpr juce::uint32 sourceFrameTimeout = 2000;
+
+    private:
+        std::shared_ptr<ComposedClip> clip;
+        double                        startTime = 0.0;
+        double                        endTime   = 0.0;
+        juce::AudioBuffer<float>      buffer;
+        Compositor::LayerList         layers;
+        VideoFrame                    frame;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CacheRenderJob)
+    };
+
+    /** Returns true, if the background composition has the frame for pts ready */
+    bool isComposedFrameAvailable (double pts) const;
+
+    /** Copies the frame for pts from the background composition into target, returns false if it isn't ready */
+    bool getComposedFrame (double pts, VideoFrame& target);
+
+    /** Returns true, if the frames of all clips needed at pts are decoded */
+    bool isSourceFrameAvailable (double pts) const;
+
+    /**
+     Composites the clips at pts into the target frame.
+     @param discardCoveredVideo lets clips, that stay covered, skip decoding. Only the path
+                                following the playback sets it, so other requests don't
+                                discard frames the playback still needs.
+     */
+    void compositeFrame (VideoFrame& target, double pts, Compositor::LayerList& layersToUse, bool discardCoveredVideo = false);
+
+    /** Returns true, if the audio was pulled recently, i.e. the clip is playing */
+    bool isPlaying() const;
+
+    /** A clip visible at a time with it's local time and automated geometry */
+    struct VisibleClip
+    {
+        ClipDescriptor*                 descriptor = nullptr;
+        double                          localPts   = 0.0;
+        ClipDescriptor::VideoTransform  transform;
+    };
+
+    /** A clip hidden by a static opaque clip above, that doesn't need video until discardUntil */
+    struct CoveredClip
+    {
+        ClipDescriptor* descriptor   = nullptr;
+        double          discardUntil = 0.0;
+    };
+
+    /**
+     Returns the clips visible at pts in z-order, leaving out clips covered by an opaque clip
+     above. This only queries the state, so it can be used for hashes from any thread.
+     @param covered if not null, receives the clips, that stay covered and can discard their video
+     */
+    std::vector<VisibleClip> getVisibleClips (const ClipTimeline& snapshot, double pts, juce::Rectangle<float> area, float alphaExtern,
+                                              std::vector<CoveredClip>* covered = nullptr) const;
+
+    /**
+     Adds the layers of the visible clips, nested edits add their composed image as one layer.
+     The video automation of the clips is updated here, so call this with the compositingLock held.
+     */
+    void addLayersOfClips (Compositor::LayerList& layers, const std::vector<VisibleClip>& clips, juce::Rectangle<float> area, float alphaExtern);
+
+    /**
+     Returns a hash of everything, that changes the composed frame of the visible clips: the clips
+     in z-order, their media, shown frame, video processors and parameter values, and nested edits.
+     The media is identified by it's name, size and modification time. persistent is set to false, if a clip
+     has no local media file, so the hash is not valid in another session.
+     */
+    juce::uint64 getStateHash (const std::vector<VisibleClip>& visible, juce::Rectangle<float> area, bool& persistent);
+
+    /** Calculates the state hash of the frame at pts and returns true, if it can be used for the RenderCache */
+    bool getRenderCacheHash (double pts, juce::uint64& stateHash);
+
+    /**
+     Returns the frame at pts composited into an image of that size. The image is kept in the
+     FrameCache of the VideoEngine under the state hash, so all instances of a nested edit and
+     all views showing the same state composite it only once per frame.
+     */
+    juce::Image getComposedImage (double pts, Size size);
+
+    /** Returns the size in pixels the frame occupies when drawn with the placement, at most the frame size */
+    Size getPlacedSize (const juce::AffineTransform& placement) const;
+
+    /** Returns the transform to draw an image of the placed size with the placement */
+    juce::AffineTransform getPlacedImageTransform (Size size, const juce::AffineTransform& placement) const;
+
+    /** Lets all clips prepare their video again, after a change might have uncovered them */
+    void resetDiscardedVideo();
+
+    /** Returns the index in the clips vector of a clip state, not counting other children */
+    int getClipIndex (const juce::ValueTree& clipState) const;
+
     juce::CriticalSection clipDescriptorLock;
 
+    /** keeps the automation updates of compositing to one thread at a time */
+    juce::CriticalSection compositingLock;
+
     juce::ValueTree state;
     bool manualStateChange = false;
 
+    int  batchEditDepth = 0;
+    bool pendingPublish = false;
+    bool pendingInvalidate = false;
+    bool pendingSampleCounts = false;
+
     AudioStreamSettings audioSettings;
     VideoStreamSettings videoSettings;
 
     std::unique_ptr<AudioMixer> audioMixer;
 
-    std::vector<std::shared_ptr<ClipDescriptor>> clips;
+    /**
+     The clips of a block spanning several segments. The message thread allocates a buffer for the
+     capacity of each published timeline and frees the ones, the audio thread doesn't use any more.
+     */
+    std::vector<std::unique_ptr<ClipTimeline::RangeBuffer>> audioClipsBuffers;
+    std::atomic<ClipTimeline::RangeBuffer*> pendingAudioClipsBuffer { nullptr };
+    std::atomic<ClipTimeline::RangeBuffer*> activeAudioClipsBuffer  { nullptr };
+    size_t                                  audioClipsCapacity = 0;
+
+    ClipList                     clips;
+    BusList                      buses;
+    AtomicSnapshot<ClipTimeline> timeline;
+
     std::atomic<int64_t> position = {};
+    std::atomic<double>  preRollTime { 2.0 };
     VideoFrame           frame;
+    Compositor::LayerList layers;
+
+    FrameCache                composedFrameCache { 256 * 1024 * 1024 };
+    VideoFifo                 composedFrames { 8 };
+
+    /** the CompositionJob writes and resets composedFrames, the views read them, both under this lock */
+    juce::CriticalSection     composedFramesLock;
+    CompositionJob            compositionJob { *this };
+    VideoFrame                lastComposedFrame;
+    std::atomic<bool>         resetComposition { true };
+    std::atomic<bool>         skipLateFrames { true };
+    std::atomic<juce::uint32> lastFrameRequest { 0 };
+    std::atomic<juce::uint32> lastAudioBlock { 0 };
+
+    std::unique_ptr<CacheRenderJob> cacheRenderJob;
 
     int64_t lastShownFrame;
 
+    friend ClipDescriptor;
+    friend AudioBus;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComposedClip)
 };
 
@@ -47,8 +47,22 @@ void ImageClip::setMediaFile (const juce::URL& media)
 
 void ImageClip::setImage (const juce::Image& imageToUse)
 {
-    frame.image = imageToUse;
+    // the Compositor works on ARGB, converting once saves it from converting each frame
+    frame.image = imageToUse.convertedToFormat (juce::Image::ARGB);
     frame.timecode = 0;
+    ++imageRevision;
+
+    // an opaque image lets the Compositor skip the clips below
+    opaque = frame.image.isValid();
+    if (opaque)
+    {
+        const juce::Image::BitmapData data (frame.image, juce::Image::BitmapData::readOnly);
+        for (int y = 0; y < data.height && opaque; ++y)
+        {
+            const auto* pixels = reinterpret_cast<const juce::PixelARGB*> (data.getLinePointer (y));
+            opaque = std::all_of (pixels, pixels + data.width, [](const auto& pixel) { return pixel.getAlpha() == 255; });
+        }
+    }
 
     videoSettings.frameSize.width = frame.image.getWidth();
     videoSettings.frameSize.height = frame.image.getHeight();
@@ -76,6 +76,12 @@ public:
     bool hasVideo() const override    { return true; }
     bool hasAudio() const override    { return false; }
 
+    /** Returns true, if the image has no transparent pixels */
+    bool isOpaque() const override    { return opaque; }
+
+    /** The image only changes, when setImage() is called */
+    juce::int64 getFrameIdentifier (double) override  { return imageRevision; }
+
     std::shared_ptr<AVClip> createCopy (StreamTypes types) override;
 
     double getSampleRate() const override;
@@ -85,6 +91,8 @@ private:
     juce::URL           mediaFile;
     VideoFrame          frame;
     VideoStreamSettings videoSettings;
+    bool                opaque = false;
+    std::atomic<juce::int64> imageRevision { 0 };
 
     double sampleRate = 0.0;
 
@@ -28,10 +28,16 @@ MovieClip::MovieClip (VideoEngine& engine)
     addDefaultVideoParameters (*this);
 }
 
+MovieClip::~MovieClip()
+{
+    delete decoder.exchange (nullptr);
+}
+
 juce::String MovieClip::getDescription() const
 {
-    if (movieReader)
-        return movieReader->getMediaFile().getFileNameWithoutExtension();
+    auto& d = getDecoder();
+    if (d.reader)
+        return d.reader->getMediaFile().getFileNameWithoutExtension();
 
     return "MovieClip";
 }
@@ -42,8 +48,9 @@ bool MovieClip::openFromFile (const juce::File file)
     if (engine == nullptr)
         return false;
 
-    const auto wasSuspended = backgroundJob.isSuspended();
-    backgroundJob.setSuspended (true);
+    auto& d = getDecoder();
+    const auto wasSuspended = d.backgroundJob.isSuspended();
+    d.backgroundJob.setSuspended (true);
 
     auto reader = engine->createReaderFor (file);
     if (reader->isOpenedOk())
@@ -54,7 +61,7 @@ bool MovieClip::openFromFile (const juce::File file)
             setThumbnailReader ({});
 
         setReader (std::move (reader));
-        backgroundJob.setSuspended (wasSuspended);
+        d.backgroundJob.setSuspended (wasSuspended);
         return true;
     }
 
@@ -63,30 +70,36 @@ bool MovieClip::openFromFile (const juce::File file)
 
 juce::URL MovieClip::getMediaFile() const
 {
-    if (movieReader)
-        return juce::URL (movieReader->getMediaFile());
+    auto& d = getDecoder();
+    if (d.reader)
+        return juce::URL (d.reader->getMediaFile());
 
     return {};
 }
 
 void MovieClip::setReader (std::unique_ptr<AVReader> readerToUse)
 {
-    backgroundJob.setSuspended (true);
+    auto& d = getDecoder();
+    d.backgroundJob.setSuspended (true);
 
-    movieReader = std::move (readerToUse);
-    audioFifo.setNumChannels (movieReader->numChannels);
-    audioFifo.setSampleRate (sampleRate);
-    audioFifo.setPosition (0);
+    d.reader = std::move (readerToUse);
+
+    if (auto* engine = getVideoEngine())
+        d.reader->setFrameCache (&engine->getFrameCache());
+
+    d.audioFifo.setNumChannels (d.reader->numChannels);
+    d.audioFifo.setSampleRate (sampleRate);
+    d.audioFifo.setPosition (0);
 
     if (sampleRate > 0)
-        movieReader->setOutputSampleRate (sampleRate);
+        d.reader->setOutputSampleRate (sampleRate);
 
     if (hasVideo())
-        videoFifo.setVideoSettings (movieReader->getVideoSettings (0));
+        d.videoFifo.setVideoSettings (d.reader->getVideoSettings (0));
 
-    videoFifo.clear();
+    d.videoFifo.clear();
 
-    backgroundJob.setSuspended (false);
+    d.backgroundJob.setSuspended (false);
 }
 
 void MovieClip::setThumbnailReader (std::unique_ptr<AVReader> reader)
@@ -96,25 +109,27 @@ void MovieClip::setThumbnailReader (std::unique_ptr<AVReader> reader)
 
 Size MovieClip::getVideoSize() const
 {
-    return (movieReader != nullptr) ? movieReader->originalSize : Size();
+    auto& d = getDecoder();
+    return (d.reader != nullptr) ? d.reader->originalSize : Size();
 }
 
 double MovieClip::getLengthInSeconds() const
 {
-    if (movieReader && movieReader->isOpenedOk())
-        return movieReader->getTotalLength() / movieReader->sampleRate;
+    auto& d = getDecoder();
+    if (d.reader && d.reader->isOpenedOk())
+        return d.reader->getTotalLength() / d.reader->sampleRate;
 
     return {};
 }
 
 double MovieClip::getCurrentTimeInSeconds() const
 {
-    return sampleRate == 0 ? 0 : nextReadPosition / sampleRate;
+    return sampleRate == 0 ? 0 : getDecoder().nextReadPosition / sampleRate;
 }
 
 VideoFrame& MovieClip::getFrame (double pts)
 {
-    return videoFifo.getFrameSeconds (pts);
+    return getDecoder().videoFifo.getFrameSeconds (pts);
 }
 
 void MovieClip::render (juce::Graphics& view, juce::Rectangle<float> area, double pts, float rotation, float zoom, juce::Point<float> translation, float alpha)
@@ -131,7 +146,7 @@ void MovieClip::render (OpenGLView& view, double pts, float rotation, float zoom
 
 bool MovieClip::isFrameAvailable (double pts) const
 {
-    return videoFifo.isFrameAvailable (pts);
+    return getDecoder().videoFifo.isFrameAvailable (pts);
 }
 
 juce::Image MovieClip::getStillImage (double seconds, Size size)
@@ -144,33 +159,38 @@ juce::Image MovieClip::getStillImage (double seconds, Size size)
 
 void MovieClip::prepareToPlay (int, double sampleRateToUse)
 {
+    auto& d = getDecoder();
+
     sampleRate = sampleRateToUse;
-    audioFifo.setNumSamples (juce::roundToInt (sampleRate));
-    audioFifo.setSampleRate (sampleRate);
+    d.sampleRate = sampleRateToUse;
+    d.audioFifo.setNumSamples (juce::roundToInt (sampleRate));
+    d.audioFifo.setSampleRate (sampleRate);
 
-    if (movieReader)
-        movieReader->setOutputSampleRate (sampleRate);
+    if (d.reader)
+        d.reader->setOutputSampleRate (sampleRate);
 
-    backgroundJob.setSuspended (false);
+    d.backgroundJob.setSuspended (false);
 }
 
 void MovieClip::releaseResources()
 {
     sampleRate = 0;
+    getDecoder().sampleRate = 0;
 }
 
 bool MovieClip::waitForSamplesReady (int samples, int timeout)
 {
     jassert (samples > 0 && samples <= 4800);
 
-    if (movieReader && movieReader->isOpenedOk() && movieReader->hasAudio())
+    auto& d = getDecoder();
+    if (d.reader && d.reader->isOpenedOk() && d.reader->hasAudio())
     {
         const auto start = juce::Time::getMillisecondCounter();
 
-        while (audioFifo.getAvailableSamples() < samples && int (juce::Time::getMillisecondCounter() - start) < timeout)
+        while (d.audioFifo.getAvailableSamples() < samples && int (juce::Time::getMillisecondCounter() - start) < timeout)
             juce::Thread::sleep (5);
 
-        return audioFifo.getAvailableSamples() >= samples;
+        return d.audioFifo.getAvailableSamples() >= samples;
     }
     else
     {
@@ -181,27 +201,31 @@ bool MovieClip::waitForSamplesReady (int samples, int timeout)
 bool MovieClip::waitForFrameReady (double pts, int timeout)
 {
     const auto start = juce::Time::getMillisecondCounter();
+    auto& d = getDecoder();
 
-    while (videoFifo.isFrameAvailable (pts) == false && int (juce::Time::getMillisecondCounter() - start) < timeout)
+    while (d.videoFifo.isFrameAvailable (pts) == false && int (juce::Time::getMillisecondCounter() - start) < timeout)
         juce::Thread::sleep (1);
 
-    return videoFifo.isFrameAvailable (pts);
+    return d.videoFifo.isFrameAvailable (pts);
 }
 
 void MovieClip::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
 {
-    const auto gain = float (juce::Decibels::decibelsToGain (getAudioParameters().at(IDs::gain)->getRealValue()));
+    const auto gain = getAudioGain();
 
-    if (movieReader && movieReader->isOpenedOk() && movieReader->hasAudio())
+    auto& d = getDecoder();
+    if (d.reader && d.reader->isOpenedOk() && d.reader->hasAudio())
     {
-        audioFifo.pullSamples (info);
-        info.buffer->applyGainRamp (info.startSample, info.numSamples, lastGain, gain);
+        d.audioFifo.pullSamples (info);
+
+        if (shouldApplyAudioGain())
+            info.buffer->applyGainRamp (info.startSample, info.numSamples, lastGain, gain);
     }
     else
     {
         info.clearActiveBufferRegion();
     }
-    nextReadPosition += info.numSamples;
+    d.nextReadPosition += info.numSamples;
     lastGain = gain;
 
     triggerAsyncUpdate();
@@ -209,19 +233,34 @@ void MovieClip::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
 
 bool MovieClip::hasVideo() const
 {
-    return movieReader ? movieReader->hasVideo() : false;
+    auto& d = getDecoder();
+    return d.reader ? d.reader->hasVideo() : false;
 }
 
 bool MovieClip::hasAudio() const
 {
-    return movieReader ? movieReader->hasAudio() : false;
+    auto& d = getDecoder();
+    return d.reader ? d.reader->hasAudio() : false;
+}
+
+bool MovieClip::isOpaque() const
+{
+    return hasVideo();
+}
+
+void MovieClip::discardVideoUntil (double pts)
+{
+    auto& d = getDecoder();
+    if (d.reader)
+        d.reader->setVideoDiscardedUntil (pts);
 }
 
 double MovieClip::getFrameDurationInSeconds() const
 {
-    if (movieReader.get() != nullptr)
+    auto& d = getDecoder();
+    if (d.reader.get() != nullptr)
     {
-        const auto& settings = movieReader->getVideoSettings (0);
+        const auto& settings = d.reader->getVideoSettings (0);
         return double (settings.defaultDuration) / double (settings.timebase);
     }
 
@@ -247,7 +286,7 @@ void MovieClip::handleAsyncUpdate()
     if (sampleRate > 0 && hasVideo())
     {
         auto seconds = getCurrentTimeInSeconds();
-        const auto& frame = videoFifo.getFrameSeconds (seconds);
+        const auto& frame = getDecoder().videoFifo.getFrameSeconds (seconds);
         if (frame.timecode != lastShownFrame)
         {
             sendTimecode (frame.timecode, seconds, juce::sendNotificationAsync);
@@ -258,38 +297,40 @@ void MovieClip::handleAsyncUpdate()
 
 void MovieClip::setNextReadPosition (juce::int64 samples)
 {
-    backgroundJob.setSuspended (true);
+    auto& d = getDecoder();
+    d.backgroundJob.setSuspended (true);
 
-    nextReadPosition = samples;
-    audioFifo.setPosition (samples);
-    if (movieReader && sampleRate > 0)
+    d.nextReadPosition = samples;
+    d.audioFifo.setPosition (samples);
+    if (d.reader && sampleRate > 0)
     {
         auto time = samples / sampleRate;
-        if (sampleRate == movieReader->sampleRate)
+        if (sampleRate == d.reader->sampleRate)
         {
-            movieReader->setPosition (samples);
+            d.reader->setPosition (samples);
         }
         else
         {
-            movieReader->setPosition (juce::int64 (time * movieReader->sampleRate));
+            d.reader->setPosition (juce::int64 (time * d.reader->sampleRate));
         }
     }
 
-    videoFifo.clear();
+    d.videoFifo.clear();
 
-    backgroundJob.setSuspended (false);
+    d.backgroundJob.setSuspended (false);
     triggerAsyncUpdate();
 }
 
 juce::int64 MovieClip::getNextReadPosition() const
 {
-    return nextReadPosition;
+    return getDecoder().nextReadPosition;
 }
 
 juce::int64 MovieClip::getTotalLength() const
 {
-    if (movieReader && movieReader->isOpenedOk())
-        return movieReader->getTotalLength();
+    auto& d = getDecoder();
+    if (d.reader && d.reader->isOpenedOk())
+        return d.reader->getTotalLength();
 
     return 0;
 }
@@ -304,21 +345,44 @@ void MovieClip::setLooping (bool shouldLoop)
     loop = shouldLoop;
 }
 
-MovieClip::BackgroundReaderJob::BackgroundReaderJob (MovieClip& ownerToUse)
-    : owner (ownerToUse)
+bool MovieClip::canContinue (const MovieClip& previous) const
+{
+    return this != &previous
+        && getMediaFile() == previous.getMediaFile();
+}
+
+bool MovieClip::takeOverDecoder (MovieClip& previous)
+{
+    if (! canContinue (previous) || sampleRate <= 0 || sampleRate != previous.sampleRate)
+        return false;
+
+    // the decoders are never deleted while the clips live, so other threads can keep using them
+    auto* continuing = previous.decoder.load();
+    auto* idle = decoder.exchange (continuing);
+    previous.decoder.store (idle);
+    return true;
+}
+
+MovieClip::Decoder& MovieClip::getDecoder() const
+{
+    return *decoder.load();
+}
+
+MovieClip::BackgroundReaderJob::BackgroundReaderJob (Decoder& decoderToUse)
+    : decoder (decoderToUse)
 {
 }
 
 int MovieClip::BackgroundReaderJob::useTimeSlice()
 {
     if (suspended == false &&
-        owner.sampleRate > 0 &&
-        owner.movieReader.get() != nullptr &&
-        (owner.hasAudio() == false || owner.audioFifo.getFreeSpace() > 2048) &&
-        (owner.hasVideo() == false || owner.videoFifo.getFreeSpace() > 3))
+        decoder.sampleRate > 0 &&
+        decoder.reader.get() != nullptr &&
+        (decoder.reader->hasAudio() == false || decoder.audioFifo.getFreeSpace() > 2048) &&
+        (decoder.reader->hasVideo() == false || decoder.videoFifo.getFreeSpace() > 3))
     {
         juce::ScopedValueSetter<bool> guard (inDecodeBlock, true);
-        owner.movieReader->readNewData (owner.videoFifo, owner.audioFifo);
+        decoder.reader->readNewData (decoder.videoFifo, decoder.audioFifo);
         return 3;
     }
 
@@ -340,7 +404,7 @@ bool MovieClip::BackgroundReaderJob::isSuspended() const
 
 juce::TimeSliceClient* MovieClip::getBackgroundJob()
 {
-    return &backgroundJob;
+    return &getDecoder().backgroundJob;
 }
 
 } // foleys
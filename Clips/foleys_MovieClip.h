@@ -40,6 +40,7 @@ class MovieClip   : public AVClip,
 {
 public:
     MovieClip (VideoEngine& videoEngine);
+    ~MovieClip() override;
 
     /** Used to identify the clip type to the user */
     juce::String getClipType() const override { return NEEDS_TRANS ("Movie"); }
@@ -85,6 +86,12 @@ public:
     bool hasVideo() const override;
     bool hasAudio() const override;
 
+    /** The decoded video has no alpha channel, so the frames are always opaque */
+    bool isOpaque() const override;
+
+    /** Lets the reader skip converting frames, that are covered in the composition */
+    void discardVideoUntil (double pts) override;
+
     double getFrameDurationInSeconds() const override;
 
     std::shared_ptr<AVClip> createCopy (StreamTypes types) override;
@@ -97,44 +104,69 @@ public:
 
     bool waitForFrameReady (double pts, int timeout=1000) override;
 
+    /**
+     Returns true, if this clip plays the same media and could continue the decoder of previous.
+     Both clips also need to be prepared with the same sample rate for takeOverDecoder().
+     */
+    bool canContinue (const MovieClip& previous) const;
+
+    /**
+     Exchanges the decoder with it's buffers with the one of previous. This is used by the
+     ComposedClip at a cut between two clips, that are continuous in the same media, so this
+     clip continues without seeking. The previous clip gets the idle decoder of this clip.
+     This doesn't block or allocate, so it can be called from the audio thread, as long as
+     no other thread is reading audio from either clip.
+     */
+    bool takeOverDecoder (MovieClip& previous);
+
 private:
 
     void handleAsyncUpdate() override;
 
+    struct Decoder;
+
     /** @internal */
     class BackgroundReaderJob : public juce::TimeSliceClient
     {
     public:
-        BackgroundReaderJob (MovieClip& owner);
+        BackgroundReaderJob (Decoder& decoder);
 
         int useTimeSlice() override;
 
         void setSuspended (bool s);
         bool isSuspended() const;
     private:
-        MovieClip& owner;
+        Decoder& decoder;
         std::atomic<bool> suspended = true;
         bool inDecodeBlock = false;
     };
 
-    BackgroundReaderJob backgroundJob {*this};
-    friend BackgroundReaderJob;
+    /** The reader with it's buffers and the job to read ahead. It is handed over
+        between clips with takeOverDecoder(). */
+    struct Decoder
+    {
+        std::unique_ptr<AVReader> reader;
+        VideoFifo                 videoFifo { 30 };
+        AudioFifo                 audioFifo;
+        BackgroundReaderJob       backgroundJob { *this };
+        std::atomic<double>       sampleRate { 0.0 };
+        int64_t                   nextReadPosition = 0;
+    };
+
+    Decoder& getDecoder() const;
+
+    std::atomic<Decoder*> decoder { new Decoder() };
 
-    std::unique_ptr<AVReader> movieReader;
     std::unique_ptr<AVReader> thumbnailReader;
     std::vector<juce::LagrangeInterpolator> resamplers;
 
     double  sampleRate = {};
-    int64_t nextReadPosition = 0;
     int64_t lastShownFrame = -1;
     bool    loop = false;
     float   lastGain = 0.0;
 
     Size originalSize;
 
-    VideoFifo videoFifo { 30 };
-    AudioFifo audioFifo;
-
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MovieClip)
 };
 
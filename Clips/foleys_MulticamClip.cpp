@@ -0,0 +1,500 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+
+namespace foleys
+{
+
+namespace IDs
+{
+    static juce::Identifier angle { "angle" };
+}
+
+MulticamClip::MulticamClip (VideoEngine& engine)
+  : AVClip (engine)
+{
+    addDefaultAudioParameters (*this);
+    addDefaultVideoParameters (*this);
+
+    auto angle = std::make_unique<ProcessorParameterFloat>(IDs::angle, "Angle", juce::NormalisableRange<double>(0.0, maximumNumAngles - 1.0, 1.0), 0.0);
+    angle->getProperties().set (IDs::colour, "ffa0a000");
+    angleParameter = angle.get();
+    addVideoParameter (std::move (angle));
+}
+
+std::shared_ptr<MulticamClip> MulticamClip::createFromUrl (VideoEngine& engine, const juce::URL& url, StreamTypes types)
+{
+    auto clip = std::make_shared<MulticamClip> (engine);
+
+    const auto& names  = url.getParameterNames();
+    const auto& values = url.getParameterValues();
+
+    for (int i = 0; i < maximumNumAngles; ++i)
+    {
+        const auto index = names.indexOf ("angle" + juce::String (i));
+        if (index < 0)
+            break;
+
+        // skipping the angle would shift the indices of the following angles, which the
+        // angle automation and the audio angle refer to
+        auto angle = engine.createClipFromFile (juce::URL (values [index]), types);
+        if (angle == nullptr)
+        {
+            FOLEYS_LOG ("Could not load angle " << i << ": " << values [index]);
+            return {};
+        }
+
+        const auto offsetIndex = names.indexOf ("offset" + juce::String (i));
+        clip->addAngle (angle, offsetIndex >= 0 ? values [offsetIndex].getDoubleValue() : 0.0);
+    }
+
+    const auto audioIndex = names.indexOf ("audio");
+    if (audioIndex >= 0)
+        clip->setAudioAngle (values [audioIndex].getIntValue());
+
+    return clip;
+}
+
+juce::URL MulticamClip::getMediaFile() const
+{
+    juce::URL url (juce::String (scheme) + "://angles");
+
+    auto list = angles.read();
+    for (size_t i = 0; i < list->size(); ++i)
+    {
+        const auto& angle = (*list)[i];
+        url = url.withParameter ("angle" + juce::String (i), angle.clip->getMediaFile().toString (true))
+                 .withParameter ("offset" + juce::String (i), juce::String (angle.syncOffset));
+    }
+
+    return url.withParameter ("audio", juce::String (audioAngle.load()));
+}
+
+juce::String MulticamClip::getDescription() const
+{
+    return NEEDS_TRANS ("Multicam") + " (" + juce::String (getNumAngles()) + ")";
+}
+
+int MulticamClip::addAngle (std::shared_ptr<AVClip> clip, double syncOffset)
+{
+    jassert (clip != nullptr);
+    jassert (getNumAngles() < maximumNumAngles);
+
+    // the gain of the MulticamClip applies
+    clip->setApplyAudioGain (false);
+
+    if (sampleRate > 0)
+        clip->prepareToPlay (blockSize, sampleRate);
+
+    auto list = std::make_unique<AngleList> (*angles.read());
+    list->push_back ({ clip, syncOffset });
+    seekAngle (list->back(), position);
+
+    const auto index = int (list->size()) - 1;
+    publishAngles (std::move (list));
+    return index;
+}
+
+void MulticamClip::removeAngle (int index)
+{
+    auto list = std::make_unique<AngleList> (*angles.read());
+    if (! juce::isPositiveAndBelow (index, list->size()))
+        return;
+
+    list->erase (list->begin() + index);
+    publishAngles (std::move (list));
+}
+
+int MulticamClip::getNumAngles() const
+{
+    return int (angles.read()->size());
+}
+
+std::shared_ptr<AVClip> MulticamClip::getAngle (int index) const
+{
+    auto list = angles.read();
+    if (juce::isPositiveAndBelow (index, list->size()))
+        return (*list)[size_t (index)].clip;
+
+    return {};
+}
+
+void MulticamClip::setSyncOffset (int index, double syncOffset)
+{
+    auto list = std::make_unique<AngleList> (*angles.read());
+    if (! juce::isPositiveAndBelow (index, list->size()))
+        return;
+
+    auto& angle = (*list)[size_t (index)];
+    angle.syncOffset = syncOffset;
+    seekAngle (angle, position);
+
+    publishAngles (std::move (list));
+}
+
+double MulticamClip::getSyncOffset (int index) const
+{
+    auto list = angles.read();
+    if (juce::isPositiveAndBelow (index, list->size()))
+        return (*list)[size_t (index)].syncOffset;
+
+    return 0.0;
+}
+
+void MulticamClip::setActiveAngle (int index)
+{
+    angleParameter->setRealValue (index);
+}
+
+int MulticamClip::getActiveAngle() const
+{
+    return juce::roundToInt (angleParameter->getRealValue());
+}
+
+void MulticamClip::setAudioAngle (int index)
+{
+    audioAngle = index;
+}
+
+int MulticamClip::getAudioAngle() const
+{
+    return audioAngle;
+}
+
+void MulticamClip::publishAngles (std::unique_ptr<AngleList> list)
+{
+    angles.publish (std::move (list));
+}
+
+AVClip* MulticamClip::getActiveClip (const AngleList& list, double& syncOffset) const
+{
+    const auto index = getActiveAngle();
+    if (! juce::isPositiveAndBelow (index, list.size()))
+        return nullptr;
+
+    const auto& angle = list [size_t (index)];
+    syncOffset = angle.syncOffset;
+    return angle.clip.get();
+}
+
+void MulticamClip::seekAngle (const Angle& angle, int64_t pos)
+{
+    if (sampleRate <= 0)
+        return;
+
+    angle.clip->setNextReadPosition (std::max (juce::int64 (pos + angle.syncOffset * sampleRate), juce::int64 (0)));
+}
+
+juce::Image MulticamClip::getGridPreview (double pts, Size size)
+{
+    if (gridImage.getWidth() != size.width || gridImage.getHeight() != size.height)
+        gridImage = juce::Image (juce::Image::ARGB, size.width, size.height, true);
+    else
+        gridImage.clear (gridImage.getBounds());
+
+    auto list = angles.read();
+    if (list->empty())
+        return gridImage;
+
+    const auto columns = int (std::ceil (std::sqrt (double (list->size()))));
+    const auto rows = (int (list->size()) + columns - 1) / columns;
+    const auto cellWidth  = size.width  / float (columns);
+    const auto cellHeight = size.height / float (rows);
+
+    juce::Graphics g (gridImage);
+    g.setImageResamplingQuality (juce::Graphics::lowResamplingQuality);
+
+    for (size_t i = 0; i < list->size(); ++i)
+    {
+        const auto& angle = (*list)[i];
+        const auto cell = juce::Rectangle<float> ((i % size_t (columns)) * cellWidth, (i / size_t (columns)) * cellHeight, cellWidth, cellHeight);
+
+        if (angle.clip->hasVideo())
+        {
+            const auto& frame = angle.clip->getFrame (pts + angle.syncOffset);
+            if (frame.image.isValid())
+                g.drawImage (frame.image, cell.reduced (1.0f), juce::RectanglePlacement::centred);
+        }
+
+        if (int (i) == getActiveAngle())
+        {
+            g.setColour (juce::Colours::red);
+            g.drawRect (cell, 2.0f);
+        }
+    }
+
+    return gridImage;
+}
+
+Size MulticamClip::getVideoSize() const
+{
+    auto list = angles.read();
+    for (const auto& angle : *list)
+        if (angle.clip->hasVideo())
+            return angle.clip->getVideoSize();
+
+    return {};
+}
+
+double MulticamClip::getLengthInSeconds() const
+{
+    auto list = angles.read();
+    auto length = 0.0;
+    for (const auto& angle : *list)
+        length = std::max (length, angle.clip->getLengthInSeconds() - angle.syncOffset);
+
+    return length;
+}
+
+double MulticamClip::getCurrentTimeInSeconds() const
+{
+    return sampleRate > 0 ? position / sampleRate : 0.0;
+}
+
+VideoFrame& MulticamClip::getFrame (double pts)
+{
+    auto list = angles.read();
+
+    auto syncOffset = 0.0;
+    if (auto* clip = getActiveClip (*list, syncOffset))
+        return clip->getFrame (pts + syncOffset);
+
+    return emptyFrame;
+}
+
+bool MulticamClip::isFrameAvailable (double pts) const
+{
+    auto list = angles.read();
+
+    auto syncOffset = 0.0;
+    if (auto* clip = getActiveClip (*list, syncOffset))
+        return clip->isFrameAvailable (pts + syncOffset);
+
+    return false;
+}
+
+void MulticamClip::render (juce::Graphics& view, juce::Rectangle<float> area, double pts, float rotation, float zoom, juce::Point<float> translation, float alpha)
+{
+    auto list = angles.read();
+
+    auto syncOffset = 0.0;
+    if (auto* clip = getActiveClip (*list, syncOffset))
+        renderFrame (view, area, clip->getFrame (pts + syncOffset), rotation, zoom, translation, alpha);
+}
+
+#if FOLEYS_USE_OPENGL
+void MulticamClip::render (OpenGLView& view, double pts, float rotation, float zoom, juce::Point<float> translation, float alpha)
+{
+    auto list = angles.read();
+
+    auto syncOffset = 0.0;
+    if (auto* clip = getActiveClip (*list, syncOffset))
+        renderFrame (view, clip->getFrame (pts + syncOffset), rotation, zoom, translation, alpha);
+}
+#endif
+
+void MulticamClip::prepareToPlay (int samplesPerBlockExpected, double sampleRateToUse)
+{
+    blockSize = samplesPerBlockExpected;
+    sampleRate = sampleRateToUse;
+
+    auto list = angles.read();
+    for (const auto& angle : *list)
+    {
+        angle.clip->prepareToPlay (samplesPerBlockExpected, sampleRateToUse);
+        seekAngle (angle, position);
+    }
+}
+
+void MulticamClip::releaseResources()
+{
+    sampleRate = 0;
+
+    auto list = angles.read();
+    for (const auto& angle : *list)
+        angle.clip->releaseResources();
+}
+
+void MulticamClip::getNextAudioBlock (const juce::AudioSourceChannelInfo& info)
+{
+    const auto pos = position.load();
+    const auto audioIndex = size_t (audioAngle.load());
+
+    auto list = angles.read();
+
+    // all angles are read to keep them in lockstep, an angle that didn't start yet stays silent
+    auto readAngle = [&](const Angle& angle)
+    {
+        const auto anglePos = pos + juce::int64 (angle.syncOffset * sampleRate);
+        const auto skip = int (juce::jlimit (juce::int64 (0), juce::int64 (info.numSamples), -anglePos));
+        if (skip < info.numSamples)
+            angle.clip->getNextAudioBlock ({ info.buffer, info.startSample + skip, info.numSamples - skip });
+    };
+
+    // the other angles are read into the output, which is cleared afterwards, so no scratch buffer is needed
+    for (size_t i = 0; i < list->size(); ++i)
+        if (i != audioIndex)
+            readAngle ((*list)[i]);
+
+    info.clearActiveBufferRegion();
+
+    if (audioIndex < list->size())
+        readAngle ((*list)[audioIndex]);
+
+    const auto gain = getAudioGain();
+    if (shouldApplyAudioGain())
+        info.buffer->applyGainRamp (info.startSample, info.numSamples, lastGain, gain);
+
+    lastGain = gain;
+
+    position.fetch_add (info.numSamples);
+    triggerAsyncUpdate();
+}
+
+void MulticamClip::handleAsyncUpdate()
+{
+    angles.releaseRetired();
+
+    if (sampleRate <= 0)
+        return;
+
+    // an angle can only drift, if it was seeked from outside, e.g. when it is used elsewhere
+    const auto pos = position.load();
+    auto list = angles.read();
+    for (const auto& angle : *list)
+    {
+        const auto expected = pos + juce::int64 (angle.syncOffset * sampleRate);
+        if (expected > 0 && std::abs (angle.clip->getNextReadPosition() - expected) > blockSize * 4)
+            seekAngle (angle, pos);
+    }
+}
+
+void MulticamClip::setNextReadPosition (juce::int64 samples)
+{
+    position = samples;
+
+    auto list = angles.read();
+    for (const auto& angle : *list)
+        seekAngle (angle, samples);
+}
+
+juce::int64 MulticamClip::getNextReadPosition() const
+{
+    return position;
+}
+
+juce::int64 MulticamClip::getTotalLength() const
+{
+    return juce::int64 (getLengthInSeconds() * sampleRate);
+}
+
+bool MulticamClip::isLooping() const
+{
+    return loop;
+}
+
+void MulticamClip::setLooping (bool shouldLoop)
+{
+    loop = shouldLoop;
+}
+
+juce::Image MulticamClip::getStillImage (double seconds, Size size)
+{
+    auto list = angles.read();
+
+    auto syncOffset = 0.0;
+    if (auto* clip = getActiveClip (*list, syncOffset))
+        return clip->getStillImage (seconds + syncOffset, size);
+
+    return {};
+}
+
+bool MulticamClip::hasVideo() const
+{
+    auto list = angles.read();
+    return std::any_of (list->begin(), list->end(), [](const auto& angle) { return angle.clip->hasVideo(); });
+}
+
+bool MulticamClip::hasAudio() const
+{
+    auto list = angles.read();
+    return std::any_of (list->begin(), list->end(), [](const auto& angle) { return angle.clip->hasAudio(); });
+}
+
+void MulticamClip::discardVideoUntil (double pts)
+{
+    // when the multicam is covered, none of the angles is visible
+    auto list = angles.read();
+    for (const auto& angle : *list)
+        angle.clip->discardVideoUntil (pts > 0.0 ? pts + angle.syncOffset : 0.0);
+}
+
+double MulticamClip::getFrameDurationInSeconds() const
+{
+    auto list = angles.read();
+    for (const auto& angle : *list)
+        if (angle.clip->hasVideo())
+            return angle.clip->getFrameDurationInSeconds();
+
+    return {};
+}
+
+std::shared_ptr<AVClip> MulticamClip::createCopy (StreamTypes types)
+{
+    auto* engine = getVideoEngine();
+    if (engine == nullptr)
+        return {};
+
+    auto copy = engine->createClipFromFile (getMediaFile(), types);
+    if (auto* multicam = dynamic_cast<MulticamClip*> (copy.get()))
+        multicam->setActiveAngle (getActiveAngle());
+
+    return copy;
+}
+
+double MulticamClip::getSampleRate() const
+{
+    return sampleRate;
+}
+
+bool MulticamClip::waitForSamplesReady (int samples, int timeout)
+{
+    const auto start = juce::Time::getMillisecondCounter();
+    auto ready = true;
+
+    auto list = angles.read();
+    for (const auto& angle : *list)
+        ready &= angle.clip->waitForSamplesReady (samples, std::max (0, timeout - int (juce::Time::getMillisecondCounter() - start)));
+
+    return ready;
+}
+
+bool MulticamClip::waitForFrameReady (double pts, int timeout)
+{
+    auto list = angles.read();
+
+    auto syncOffset = 0.0;
+    if (auto* clip = getActiveClip (*list, syncOffset))
+        return clip->waitForFrameReady (pts + syncOffset, timeout);
+
+    return true;
+}
+
+} // foleys
@@ -0,0 +1,168 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+/**
+ @class MulticamClip
+
+ The MulticamClip plays several angles of the same event, e.g. recorded by different
+ cameras. All angles are read in lockstep from the position of the MulticamClip, each
+ with its own sync offset, so switching the angle doesn't need a seek.
+
+ The visible angle is the video parameter "angle", which can be automated in a
+ ClipDescriptor like any other parameter. The audio is taken from one selectable angle.
+
+ The angles are AVClips created by the VideoEngine, so their lifetime and background
+ jobs are managed by the engine. Create a MulticamClip from a "multicam" URL using
+ the VideoEngine, or add the angles manually.
+ */
+class MulticamClip : public AVClip,
+                     private juce::AsyncUpdater
+{
+public:
+    MulticamClip (VideoEngine& videoEngine);
+
+    /** Used to identify the clip type to the user */
+    juce::String getClipType() const override { return NEEDS_TRANS ("Multicam"); }
+
+    juce::String getDescription() const override;
+
+    /** The URL scheme used to restore a MulticamClip */
+    static constexpr const char* scheme = "multicam";
+
+    /** The maximum number of angles the angle parameter can select */
+    static constexpr int maximumNumAngles = 16;
+
+    /** Creates a MulticamClip from a URL returned by getMediaFile(). Returns nullptr, if an angle can't be loaded */
+    static std::shared_ptr<MulticamClip> createFromUrl (VideoEngine& videoEngine, const juce::URL& url, StreamTypes types);
+
+    /** Returns a "multicam" URL listing the media and sync offsets of all angles */
+    juce::URL getMediaFile() const override;
+
+    /**
+     Add an angle to the clip.
+     @param clip the clip to play as angle
+     @param syncOffset is added to the time of the MulticamClip to get the time in the angle
+     @returns the index of the new angle
+     */
+    int addAngle (std::shared_ptr<AVClip> clip, double syncOffset = 0.0);
+    void removeAngle (int index);
+
+    int getNumAngles() const;
+    std::shared_ptr<AVClip> getAngle (int index) const;
+
+    /** Set the offset in seconds of an angle relative to the clip time. The angle is seeked. */
+    void setSyncOffset (int index, double syncOffset);
+    double getSyncOffset (int index) const;
+
+    /** Switch the visible angle. This sets the angle parameter, so an automation overrides it. */
+    void setActiveAngle (int index);
+    int getActiveAngle() const;
+
+    /** Select the angle, that plays the audio */
+    void setAudioAngle (int index);
+    int getAudioAngle() const;
+
+    /**
+     Returns a preview of all angles in a grid, e.g. for the user to pick an angle. The
+     frames already decoded for playback are drawn in low quality, nothing is decoded for it.
+     */
+    juce::Image getGridPreview (double pts, Size size);
+
+    Size getVideoSize() const override;
+    double getLengthInSeconds() const override;
+    double getCurrentTimeInSeconds() const override;
+
+    VideoFrame& getFrame (double pts) override;
+    bool isFrameAvailable (double pts) const override;
+
+    void render (juce::Graphics& view, juce::Rectangle<float> area, double pts, float rotation = 0.0f, float zoom = 100.0f, juce::Point<float> translation = juce::Point<float>(), float alpha = 1.0f) override;
+
+#if FOLEYS_USE_OPENGL
+    void render (OpenGLView& view, double pts, float rotation = 0.0f, float zoom = 100.0f, juce::Point<float> translation = juce::Point<float>(), float alpha = 1.0f) override;
+#endif
+
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo&) override;
+    void setNextReadPosition (juce::int64 samples) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+    void setLooping (bool shouldLoop) override;
+
+    juce::Image getStillImage (double seconds, Size size) override;
+
+    bool hasVideo() const override;
+    bool hasAudio() const override;
+
+    void discardVideoUntil (double pts) override;
+
+    double getFrameDurationInSeconds() const override;
+
+    std::shared_ptr<AVClip> createCopy (StreamTypes types) override;
+
+    double getSampleRate() const override;
+
+    bool waitForSamplesReady (int samples, int timeout=1000) override;
+    bool waitForFrameReady (double pts, int timeout=1000) override;
+
+private:
+    struct Angle
+    {
+        std::shared_ptr<AVClip> clip;
+        double                  syncOffset = 0.0;
+    };
+
+    using AngleList = std::vector<Angle>;
+
+    void handleAsyncUpdate() override;
+
+    void publishAngles (std::unique_ptr<AngleList> angles);
+
+    /** Returns the angle selected by the parameter or nullptr */
+    AVClip* getActiveClip (const AngleList& angles, double& syncOffset) const;
+
+    /** Seeks an angle to the position, taking the sync offset into account */
+    void seekAngle (const Angle& angle, int64_t pos);
+
+    AtomicSnapshot<AngleList> angles;
+
+    ProcessorParameter* angleParameter = nullptr;
+
+    std::atomic<int>     audioAngle { 0 };
+    std::atomic<int64_t> position { 0 };
+    std::atomic<double>  sampleRate { 0.0 };
+    int                  blockSize = 0;
+    bool                 loop = false;
+    float                lastGain = 0.0f;
+
+    VideoFrame  emptyFrame;
+    juce::Image gridImage;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MulticamClip)
+};
+
+} // foleys
@@ -73,28 +73,41 @@ public:
         blueGamma       = state.getRawParameterValue (IDs::blueGamma);
     }
 
-    void processFrame (juce::Image& frame,
-    [[maybe_unused]]int64_t count,
-    [[maybe_unused]]const VideoStreamSettings& settings,
-    [[maybe_unused]]double clipDuration) override
+    void processFrame (juce::Image& frame, int64_t count, const VideoStreamSettings& settings, double clipDuration) override
+    {
+        if (prepareRegions (frame, count, settings, clipDuration))
+            processRegion (frame, frame, frame.getBounds());
+    }
+
+    /** Each pixel is looked up on its own, so the engine can process the rows in parallel */
+    Separability getSeparability() const override { return Separability::rows; }
+
+    bool prepareRegions ([[maybe_unused]]const juce::Image& frame,
+                         [[maybe_unused]]int64_t count,
+                         [[maybe_unused]]const VideoStreamSettings& settings,
+                         [[maybe_unused]]double clipDuration) override
     {
         red.calculateColourMap   (*redBrightness,   *redContrast,   *redGamma);
         green.calculateColourMap (*greenBrightness, *greenContrast, *greenGamma);
         blue.calculateColourMap  (*blueBrightness,  *blueContrast,  *blueGamma);
 
-        if (red.isLinear() && green.isLinear() && blue.isLinear())
-            return;
+        return ! (red.isLinear() && green.isLinear() && blue.isLinear());
+    }
 
+    void processRegion ([[maybe_unused]]const juce::Image& input, juce::Image& output, juce::Rectangle<int> region) override
+    {
         if (red.isLinear() == false && green.isLinear() && blue.isLinear())
-            red.applyLUT (frame, 2);
+            red.applyLUT (output, 2, region);
         else if (red.isLinear() && green.isLinear() == false && blue.isLinear())
-            green.applyLUT (frame, 1);
+            green.applyLUT (output, 1, region);
         else if (red.isLinear() && green.isLinear() && blue.isLinear() == false)
-            blue.applyLUT (frame, 0);
+            blue.applyLUT (output, 0, region);
         else
-            ColourCurve::applyLUTs (frame, red, green, blue);
+            ColourCurve::applyLUTs (output, red, green, blue, region);
     }
 
+    bool isTimeDependent() const override { return false; }
+
     std::vector<ProcessorParameter*> getParameters() override
     {
         return state.getParameters();
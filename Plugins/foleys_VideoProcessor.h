@@ -55,6 +55,64 @@ public:
 
     virtual std::vector<ProcessorParameter*> getParameters() = 0;
 
+    /**
+     Return false, if the output only depends on the input frame and the parameter values, but not on
+     count or clipDuration. That allows reusing the frame, while the input and the parameters don't change.
+     Transitions or generators, that change over time, must return true.
+     */
+    virtual bool isTimeDependent() const { return true; }
+
+    /** The ways a frame can be split for processRegion() */
+    enum class Separability
+    {
+        none,   ///< only processFrame() is called
+        rows,   ///< the frame is split into bands of full rows
+        tiles   ///< the frame is split into rectangular tiles
+    };
+
+    /**
+     Return rows or tiles, if each output pixel can be computed from a limited area of the input.
+     The engine will then call prepareRegions() once and processRegion() for the parts of the frame
+     concurrently on its video WorkerPool instead of processFrame().
+     */
+    virtual Separability getSeparability() const { return Separability::none; }
+
+    /**
+     Return the number of pixels around a region, that processRegion() needs to read, e.g. the radius
+     of a blur or sharpen kernel. If the halo is not zero, the engine supplies an unmodified copy of the
+     frame as input, so neighbouring regions can't see each other's results.
+     */
+    virtual int getRegionHalo() const { return 0; }
+
+    /**
+     This is called once per frame on the calling thread before processRegion(), to set up anything
+     the regions share, e.g. lookup tables. Return false, if the frame stays unchanged.
+     The arguments are the same as in processFrame().
+     */
+    virtual bool prepareRegions ([[maybe_unused]]const juce::Image& frame,
+                                 [[maybe_unused]]int64_t count,
+                                 [[maybe_unused]]const VideoStreamSettings& settings,
+                                 [[maybe_unused]]double clipDuration)
+    {
+        return true;
+    }
+
+    /**
+     Override this to process one part of the frame. It is called concurrently for different regions,
+     so it must not change any member and must only write pixels inside region.
+
+     @param input is the frame to read from. Without halo it is the same image as output
+     @param output is the image to write into
+     @param region is the part of output to produce. Reading input is allowed in region expanded by the halo
+     */
+    virtual void processRegion ([[maybe_unused]]const juce::Image& input,
+                                [[maybe_unused]]juce::Image& output,
+                                [[maybe_unused]]juce::Rectangle<int> region)
+    {
+        // getSeparability() returned rows or tiles, so this needs to be implemented
+        jassertfalse;
+    }
+
     virtual void getStateInformation (juce::MemoryBlock& destData) = 0;
 
     virtual void setStateInformation (const void* data, int sizeInBytes) = 0;
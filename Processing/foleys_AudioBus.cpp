@@ -0,0 +1,237 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+
+namespace foleys
+{
+
+AudioBus::AudioBus (ComposedClip& ownerToUse, juce::ValueTree stateToUse, juce::UndoManager* undo)
+  : owner (ownerToUse),
+    state (stateToUse),
+    undoManager (undo)
+{
+    juce::ScopedValueSetter<bool> manual (manualStateChange, true);
+
+    const auto audioProcessorsNode = state.getOrCreateChildWithName (IDs::audioProcessors, undoManager);
+    for (const auto& audioProcessor : audioProcessorsNode)
+        addAudioProcessor (std::make_unique<ProcessorController>(*this, audioProcessor, undoManager, -1));
+
+    state.addListener (this);
+}
+
+AudioBus::~AudioBus()
+{
+    state.removeListener (this);
+}
+
+juce::String AudioBus::getName() const
+{
+    return state.getProperty (IDs::name).toString();
+}
+
+void AudioBus::setName (const juce::String& name)
+{
+    state.setProperty (IDs::name, name, undoManager);
+}
+
+void AudioBus::setAudioStem (const juce::String& stemName)
+{
+    state.setProperty (IDs::stem, stemName, undoManager);
+}
+
+juce::String AudioBus::getAudioStem() const
+{
+    return state.getProperty (IDs::stem).toString();
+}
+
+int AudioBus::getAudioStemIndex() const
+{
+    return audioStemIndex.load();
+}
+
+void AudioBus::addAudioProcessor (std::unique_ptr<ProcessorController> controller, int index)
+{
+    if (auto* audioProcessor = controller->getAudioProcessor())
+        audioProcessor->prepareToPlay (owner.getSampleRate(), owner.getDefaultBufferSize());
+
+    if (manualStateChange == false)
+    {
+        juce::ScopedValueSetter<bool> manual (manualStateChange, true);
+        auto processorsNode = state.getOrCreateChildWithName (IDs::audioProcessors, undoManager);
+        processorsNode.addChild (controller->getProcessorState(), index, undoManager);
+    }
+
+    if (juce::isPositiveAndBelow (index, audioProcessors.size()))
+        audioProcessors.insert (std::next (audioProcessors.begin(), index), std::move (controller));
+    else
+        audioProcessors.push_back (std::move (controller));
+
+    publishProcessorChain();
+}
+
+void AudioBus::addAudioProcessor (std::unique_ptr<juce::AudioProcessor> processor, int index)
+{
+    addAudioProcessor (std::make_unique<ProcessorController>(*this, std::move (processor), undoManager), index);
+}
+
+void AudioBus::removeAudioProcessor (int index)
+{
+    if (! juce::isPositiveAndBelow (index, audioProcessors.size()))
+        return;
+
+    if (manualStateChange == false)
+    {
+        juce::ScopedValueSetter<bool> manual (manualStateChange, true);
+        auto processorsNode = state.getOrCreateChildWithName (IDs::audioProcessors, undoManager);
+        processorsNode.removeChild (index, undoManager);
+    }
+
+    // the audio thread might still process it, until the previous chain is retired
+    auto removed = std::next (audioProcessors.begin(), index);
+    retiredProcessors.push_back (std::move (*removed));
+    audioProcessors.erase (removed);
+
+    publishProcessorChain();
+    releaseRetiredProcessors();
+}
+
+void AudioBus::publishProcessorChain()
+{
+    auto chain = std::make_unique<ProcessorChain>();
+    for (const auto& controller : audioProcessors)
+        chain->push_back (controller.get());
+
+    processorChain.publish (std::move (chain));
+}
+
+void AudioBus::releaseRetiredProcessors()
+{
+    processorChain.releaseRetired();
+    if (processorChain.getNumRetired() == 0)
+        retiredProcessors.clear();
+}
+
+const std::vector<std::unique_ptr<ProcessorController>>& AudioBus::getAudioProcessors() const
+{
+    return audioProcessors;
+}
+
+void AudioBus::readPluginStatesIntoValueTree()
+{
+    for (auto& processor : audioProcessors)
+        processor->readPluginStatesIntoValueTree();
+}
+
+juce::ValueTree& AudioBus::getStatusTree()
+{
+    return state;
+}
+
+ComposedClip& AudioBus::getOwningClip()
+{
+    return owner;
+}
+
+const ComposedClip& AudioBus::getOwningClip() const
+{
+    return owner;
+}
+
+double AudioBus::getCurrentTimeInSeconds() const
+{
+    return owner.getCurrentTimeInSeconds();
+}
+
+void AudioBus::prepareToPlay (int numChannels, double sampleRateToUse, int samplesPerBlockExpected)
+{
+    buffer.setSize (numChannels, samplesPerBlockExpected);
+    buffer.clear();
+
+    if (sampleRate == sampleRateToUse && blockSize == samplesPerBlockExpected)
+        return;
+
+    sampleRate = sampleRateToUse;
+    blockSize  = samplesPerBlockExpected;
+
+    for (auto& controller : audioProcessors)
+        if (auto* audioProcessor = controller->getAudioProcessor())
+            audioProcessor->prepareToPlay (sampleRate, blockSize);
+}
+
+void AudioBus::releaseResources()
+{
+    for (auto& controller : audioProcessors)
+        if (auto* audioProcessor = controller->getAudioProcessor())
+            audioProcessor->releaseResources();
+
+    sampleRate = 0.0;
+    blockSize  = 0;
+}
+
+juce::AudioBuffer<float>& AudioBus::getBuffer()
+{
+    return buffer;
+}
+
+void AudioBus::processBlock (int numSamples, int64_t position)
+{
+    jassert (numSamples <= buffer.getNumSamples());
+
+    juce::AudioBuffer<float> procBuffer (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), 0, numSamples);
+    juce::MidiBuffer midiDummy;
+    auto chain = processorChain.read();
+    for (auto* controller : *chain)
+        controller->processAudio (procBuffer, midiDummy, position, owner.getSampleRate(), 0, 0.0);
+}
+
+void AudioBus::valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
+                                         const juce::Identifier& property)
+{
+    if (treeWhosePropertyHasChanged == state && (property == IDs::name || property == IDs::stem))
+        owner.publishClips();
+}
+
+void AudioBus::valueTreeChildAdded (juce::ValueTree& parentTree,
+                                    juce::ValueTree& childWhichHasBeenAdded)
+{
+    if (manualStateChange)
+        return;
+
+    juce::ScopedValueSetter<bool> manual (manualStateChange, true);
+
+    if (parentTree.getType() == IDs::audioProcessors && parentTree.getParent() == state)
+        addAudioProcessor (std::make_unique<ProcessorController>(*this, childWhichHasBeenAdded, undoManager, -1),
+                           parentTree.indexOf (childWhichHasBeenAdded));
+}
+
+void AudioBus::valueTreeChildRemoved (juce::ValueTree& parentTree,
+                                      juce::ValueTree&,
+                                      int indexFromWhichChildWasRemoved)
+{
+    if (manualStateChange)
+        return;
+
+    juce::ScopedValueSetter<bool> manual (manualStateChange, true);
+
+    if (parentTree.getType() == IDs::audioProcessors && parentTree.getParent() == state)
+        removeAudioProcessor (indexFromWhichChildWasRemoved);
+}
+
+} // foleys
@@ -0,0 +1,141 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+class ComposedClip;
+
+/**
+ @class AudioBus
+
+ An AudioBus is a submix inside a ComposedClip. Clips are routed to a bus by name
+ using ClipDescriptor::setAudioBus(). The mixer sums all clips of a bus into the
+ bus buffer, runs the bus' AudioProcessors once and adds the result to the master.
+ That way many clips can share one plugin chain, e.g. a reverb for all dialogue.
+
+ The AudioProcessors are automated in the time of the ComposedClip. The state of
+ the bus is saved as child of the ComposedClip's state.
+ */
+class AudioBus  : public TimeCodeAware,
+                  private juce::ValueTree::Listener
+{
+public:
+    /**
+     Create an AudioBus from a state. Use ComposedClip::addAudioBus() to create a new bus.
+
+     @param owner is the ComposedClip, where the AudioBus lives in.
+     @param state is the ValueTree coded state to describe this AudioBus.
+     */
+    AudioBus (ComposedClip& owner, juce::ValueTree state, juce::UndoManager* undo);
+
+    ~AudioBus() override;
+
+    /** The name of the bus, which is used to route clips to it */
+    juce::String getName() const;
+
+    /** Rename the bus. Clips routed to the old name are played on the master until
+        they are routed to the new name */
+    void setName (const juce::String& name);
+
+    /** Assign the output of this bus to an output stem of the ComposedClip */
+    void setAudioStem (const juce::String& stemName);
+    juce::String getAudioStem() const;
+
+    /** The index of the stem in ComposedClip::getAudioStems() or -1 if not assigned */
+    int getAudioStemIndex() const;
+
+    void addAudioProcessor (std::unique_ptr<ProcessorController> controller, int index=-1);
+    void addAudioProcessor (std::unique_ptr<juce::AudioProcessor> processor, int index=-1);
+    void removeAudioProcessor (int index);
+
+    const std::vector<std::unique_ptr<ProcessorController>>& getAudioProcessors() const;
+
+    /** Read all plugins getStateInformation() and save it into the statusTree as BLOB */
+    void readPluginStatesIntoValueTree();
+
+    /** Grants access to the underlying state. Your GUI may use this to add private data.
+        It is your responsibility to avoid property or child collissions. */
+    juce::ValueTree& getStatusTree();
+
+    ComposedClip& getOwningClip();
+    const ComposedClip& getOwningClip() const;
+
+    /** The bus uses the time of the owning ComposedClip */
+    double getCurrentTimeInSeconds() const override;
+
+    /** Allocates the buffer and prepares the AudioProcessors. This is called by the ComposedClip */
+    void prepareToPlay (int numChannels, double sampleRate, int samplesPerBlockExpected);
+    void releaseResources();
+
+    /** The buffer the mixer sums the clips into before calling processBlock() */
+    juce::AudioBuffer<float>& getBuffer();
+
+    /** Runs the AudioProcessors on the first numSamples of the buffer. This is called by the AudioMixer.
+        @param position is the position of the first sample in the timeline of the ComposedClip */
+    void processBlock (int numSamples, int64_t position);
+
+private:
+
+    void valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
+                                   const juce::Identifier& property) override;
+
+    void valueTreeChildAdded (juce::ValueTree& parentTree,
+                              juce::ValueTree& childWhichHasBeenAdded) override;
+
+    void valueTreeChildRemoved (juce::ValueTree& parentTree,
+                                juce::ValueTree& childWhichHasBeenRemoved,
+                                int indexFromWhichChildWasRemoved) override;
+
+    void valueTreeChildOrderChanged (juce::ValueTree&, int, int) override {}
+
+    void valueTreeParentChanged (juce::ValueTree&) override {}
+
+    /** Publishes the current audioProcessors for processBlock() */
+    void publishProcessorChain();
+
+    /** Deletes removed AudioProcessors, once the audio thread can't use them any more. This is called by the ComposedClip */
+    void releaseRetiredProcessors();
+
+    ComposedClip&      owner;
+
+    juce::ValueTree    state;
+    juce::UndoManager* undoManager = nullptr;
+    bool               manualStateChange = false;
+
+    juce::AudioBuffer<float> buffer;
+    std::atomic<int>         audioStemIndex { -1 };
+    double                   sampleRate = 0.0;
+    int                      blockSize = 0;
+
+    using ProcessorChain = std::vector<ProcessorController*>;
+
+    std::vector<std::unique_ptr<ProcessorController>> audioProcessors;
+    std::vector<std::unique_ptr<ProcessorController>> retiredProcessors;
+    AtomicSnapshot<ProcessorChain>                    processorChain;
+
+    friend ComposedClip;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioBus)
+};
+
+} // foleys
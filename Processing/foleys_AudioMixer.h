@@ -37,10 +37,40 @@ public:
 
     virtual void setup (int numChannels, double sampleRate, int samplesPerBlockExpected) = 0;
 
+    /**
+     Mix the clips into the buffer.
+     @param clips are the clips, that are active at any time of this block. The mixer
+            has to check the exact sample positions of each clip. A clip, that
+            isWaitingForDecoder(), is processed after the others, see ClipDescriptor::takeOverDecoder().
+     @param buses are the AudioBuses of the ComposedClip. Each clip is routed to the bus
+            at ClipDescriptor::getAudioBusIndex() or to the master, if the index is -1.
+            The buses need to be processed each block, even when no clip is routed to
+            them, so the tails of e.g. a reverb are not cut.
+     */
     virtual void mixAudio (const juce::AudioSourceChannelInfo& info,
                            const int64_t position,
                            const double  timeInSeconds,
-                           const std::vector<std::shared_ptr<ClipDescriptor>>& clips) = 0;
+                           const std::vector<std::shared_ptr<ClipDescriptor>>& clips,
+                           const std::vector<std::shared_ptr<AudioBus>>& buses) = 0;
+
+    /**
+     Mix the clips into the buffer and in the same pass sum the audio of the clips and
+     buses into the stems, they are assigned to (see ClipDescriptor::getAudioStemIndex()
+     and AudioBus::getAudioStemIndex()). The stems start at sample 0.
+     The default implementation only mixes the master and leaves the stems silent.
+     */
+    virtual void mixAudioWithStems (const juce::AudioSourceChannelInfo& info,
+                                    const int64_t position,
+                                    const double  timeInSeconds,
+                                    const std::vector<std::shared_ptr<ClipDescriptor>>& clips,
+                                    const std::vector<std::shared_ptr<AudioBus>>& buses,
+                                    std::vector<juce::AudioBuffer<float>>& stems)
+    {
+        for (auto& stem : stems)
+            stem.clear (0, info.numSamples);
+
+        mixAudio (info, position, timeInSeconds, clips, buses);
+    }
 
 private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioMixer)
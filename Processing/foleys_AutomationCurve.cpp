@@ -0,0 +1,121 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+
+namespace foleys
+{
+
+AutomationCurve::AutomationCurve (double valueToUse)
+  : value (valueToUse)
+{
+}
+
+AutomationCurve::AutomationCurve (const std::map<double, double>& keyframes, double valueToUse)
+  : value (valueToUse)
+{
+    times.reserve (keyframes.size());
+    values.reserve (keyframes.size());
+
+    for (const auto& keyframe : keyframes)
+    {
+        times.push_back (keyframe.first);
+        values.push_back (keyframe.second);
+    }
+}
+
+double AutomationCurve::getValueAt (double time) const
+{
+    Cursor cursor;
+    return getValueAt (time, cursor);
+}
+
+double AutomationCurve::getValueAt (double time, Cursor& cursor) const
+{
+    if (times.empty())
+        return value;
+
+    return getValueInSegment (time, findSegment (time, cursor));
+}
+
+void AutomationCurve::getValuesAt (int64_t start, int64_t interval, double timebase, double timeOffset,
+                                   float* valuesToFill, int numValues, Cursor& cursor) const
+{
+    if (times.empty())
+    {
+        juce::FloatVectorOperations::fill (valuesToFill, float (value), numValues);
+        return;
+    }
+
+    for (int i = 0; i < numValues; ++i)
+    {
+        const auto time = (start + i * interval) / timebase + timeOffset;
+        valuesToFill [i] = float (getValueInSegment (time, findSegment (time, cursor)));
+    }
+}
+
+bool AutomationCurve::isChangingBetween (double startTime, double endTime) const
+{
+    if (times.empty())
+        return false;
+
+    // without a keyframe inside the range the curve is a straight line
+    const auto next = std::upper_bound (times.begin(), times.end(), startTime);
+    if (next != times.end() && *next < endTime)
+        return true;
+
+    return getValueAt (startTime) != getValueAt (endTime);
+}
+
+size_t AutomationCurve::findSegment (double time, Cursor& cursor) const
+{
+    auto isInSegment = [&](size_t segment)
+    {
+        return segment <= times.size()
+            && (segment == 0 || times [segment - 1] <= time)
+            && (segment == times.size() || time < times [segment]);
+    };
+
+    if (isInSegment (cursor.segment))
+        return cursor.segment;
+
+    if (isInSegment (cursor.segment + 1))
+        return ++cursor.segment;
+
+    cursor.segment = size_t (std::distance (times.begin(), std::upper_bound (times.begin(), times.end(), time)));
+    return cursor.segment;
+}
+
+double AutomationCurve::getValueInSegment (double time, size_t segment) const
+{
+    if (segment == 0)
+        return values.front();
+
+    if (segment == times.size())
+        return values.back();
+
+    const auto t0 = times [segment - 1];
+    const auto t1 = times [segment];
+    const auto v0 = values [segment - 1];
+    const auto v1 = values [segment];
+
+    return juce::jlimit (0.0, 1.0, v0 + (time - t0) * (v1 - v0) / (t1 - t0));
+}
+
+} // foleys
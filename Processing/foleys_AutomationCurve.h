@@ -0,0 +1,96 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+/**
+ @class AutomationCurve
+
+ The AutomationCurve is an immutable, compiled version of the keyframes of a
+ ParameterAutomation. The keyframes are stored in flat sorted arrays, so it can
+ be evaluated from the realtime threads without locking or allocating.
+
+ The ParameterAutomation compiles a new AutomationCurve each time the keyframes
+ change and publishes it in an AtomicSnapshot.
+
+ For sequential reading use a Cursor. It remembers the segment of the last read,
+ so playing back costs amortised O(1) instead of a binary search each time.
+ */
+class AutomationCurve final
+{
+public:
+    /** Creates a curve without keyframes, that returns the value everywhere */
+    explicit AutomationCurve (double value = 0.0);
+
+    /** Creates a curve from the keyframes (time -> normalised value) */
+    AutomationCurve (const std::map<double, double>& keyframes, double value);
+
+    /**
+     A Cursor keeps the position of the last read. Each reading thread needs it's own.
+     It is only a hint, it stays valid if the curve is replaced.
+     */
+    struct Cursor
+    {
+        size_t segment = 0;
+    };
+
+    /** Returns the normalised value at the time in seconds */
+    double getValueAt (double time) const;
+
+    /** Returns the normalised value at the time in seconds, starting the search at the cursor */
+    double getValueAt (double time, Cursor& cursor) const;
+
+    /**
+     Fills values with the normalised values at the times (start + n * interval) / timebase + timeOffset.
+     This is the fastest way to read a whole block of audio or a range of frames. Using integer
+     positions, the same position always evaluates to exactly the same value.
+     @param start      the first position, e.g. in samples or in video timebase
+     @param interval   the distance between the positions
+     @param timebase   the positions per second, e.g. the sample rate
+     @param timeOffset is added to get the time in the curve, e.g. to convert into clip time
+     */
+    void getValuesAt (int64_t start, int64_t interval, double timebase, double timeOffset,
+                      float* values, int numValues, Cursor& cursor) const;
+
+    /** Returns true, if the value is not constant between the two timepoints */
+    bool isChangingBetween (double startTime, double endTime) const;
+
+    /** Returns true, if the curve has keyframes. Otherwise the value is constant */
+    bool hasKeyframes() const { return ! times.empty(); }
+
+    /** Returns the value, that is used if there are no keyframes */
+    double getValue() const { return value; }
+
+private:
+    /** returns the number of keyframes before or at the time (like upper_bound) */
+    size_t findSegment (double time, Cursor& cursor) const;
+    double getValueInSegment (double time, size_t segment) const;
+
+    std::vector<double> times;
+    std::vector<double> values;
+    double              value = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AutomationCurve)
+};
+
+} // foleys
@@ -75,12 +75,14 @@ public:
 
      @param image the image to apply the ColourCurve
      @param component is the index of the channel in the packed pixel
+     @param area is the part of the image to process, the whole image if empty
      */
-    void applyLUT (juce::Image& image, int component)
+    void applyLUT (juce::Image& image, int component, juce::Rectangle<int> area = {}) const
     {
-        juce::Image::BitmapData data (image, 0, 0,
-                                      image.getWidth(),
-                                      image.getHeight());
+        area = getArea (image, area);
+        juce::Image::BitmapData data (image, area.getX(), area.getY(),
+                                      area.getWidth(),
+                                      area.getHeight());
 
         for (int y=0; y < data.height; ++y)
         {
@@ -102,12 +104,15 @@ public:
      @param red is the ColourCurve for the red channel
      @param green is the ColourCurve for the green channel
      @param blue is the ColourCurve for the blue channel
+     @param area is the part of the image to process, the whole image if empty
      */
-    static void applyLUTs (juce::Image& image, const ColourCurve& red, const ColourCurve& green, const ColourCurve& blue)
+    static void applyLUTs (juce::Image& image, const ColourCurve& red, const ColourCurve& green, const ColourCurve& blue,
+                           juce::Rectangle<int> area = {})
     {
-        juce::Image::BitmapData data (image, 0, 0,
-                                      image.getWidth(),
-                                      image.getHeight());
+        area = getArea (image, area);
+        juce::Image::BitmapData data (image, area.getX(), area.getY(),
+                                      area.getWidth(),
+                                      area.getHeight());
 
         const auto* redMap = red.getLookupTable();
         const auto* greenMap = green.getLookupTable();
@@ -151,16 +156,19 @@ public:
      @param green is the ColourCurve for the green channel
      @param blue is the ColourCurve for the blue channel
      @param alpha is the ColourCurve for the alpha channel
+     @param area is the part of the image to process, the whole image if empty
      */
     static void applyLUTs (juce::Image& image,
                            const ColourCurve& red,
                            const ColourCurve& green,
                            const ColourCurve& blue,
-                           const ColourCurve& alpha)
+                           const ColourCurve& alpha,
+                           juce::Rectangle<int> area = {})
     {
-        juce::Image::BitmapData data (image, 0, 0,
-                                      image.getWidth(),
-                                      image.getHeight());
+        area = getArea (image, area);
+        juce::Image::BitmapData data (image, area.getX(), area.getY(),
+                                      area.getWidth(),
+                                      area.getHeight());
 
         // You need pixels with 4 components to apply 4 LUTs
         jassert (data.pixelStride == 4);
@@ -195,6 +203,11 @@ public:
     }
 
 private:
+    static juce::Rectangle<int> getArea (const juce::Image& image, juce::Rectangle<int> area)
+    {
+        return area.isEmpty() ? image.getBounds() : area.getIntersection (image.getBounds());
+    }
+
     double brightness = -1.0;
     double contrast   = -1.0;
     double gamma      = -1.0;
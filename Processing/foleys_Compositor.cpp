@@ -0,0 +1,650 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#if ! defined (FOLEYS_COMPOSITOR_SSE2) && ! defined (FOLEYS_COMPOSITOR_NEON)
+ #if JUCE_USE_SSE_INTRINSICS || defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define FOLEYS_COMPOSITOR_SSE2 1
+ #elif JUCE_USE_ARM_NEON || defined (__ARM_NEON)
+  #define FOLEYS_COMPOSITOR_NEON 1
+ #endif
+#endif
+
+#if FOLEYS_COMPOSITOR_SSE2
+ #include <emmintrin.h>
+#elif FOLEYS_COMPOSITOR_NEON
+ #include <arm_neon.h>
+#endif
+
+namespace foleys
+{
+
+//==============================================================================
+// The kernels work on premultiplied ARGB pixels with 4 bytes each, the
+// order of the components is the one of juce::PixelARGB.
+
+namespace CompositorKernels
+{
+
+#if JUCE_BIG_ENDIAN
+static constexpr int alphaIndex = 0;
+#else
+static constexpr int alphaIndex = 3;
+#endif
+
+struct Bitmap
+{
+    uint8_t* data       = nullptr;
+    int      width      = 0;
+    int      height     = 0;
+    int      lineStride = 0;
+
+    uint8_t* getPixel (int x, int y) const { return data + y * lineStride + x * 4; }
+};
+
+static inline uint32_t readPixel (const uint8_t* p)
+{
+    uint32_t value;
+    std::memcpy (&value, p, 4);
+    return value;
+}
+
+static inline void writePixel (uint8_t* p, uint32_t value)
+{
+    std::memcpy (p, &value, 4);
+}
+
+/** Blends a premultiplied pixel, that has the opacity already applied, over dst */
+static inline void blendScalar (uint8_t* dst, const int* source)
+{
+    const auto inverse = 256 - source [alphaIndex];
+    for (int c = 0; c < 4; ++c)
+        dst [c] = uint8_t (std::min (255, source [c] + ((dst [c] * inverse + 128) >> 8)));
+}
+
+static inline void bilinearBlendScalar (const uint8_t* row0, const uint8_t* row1, int fx, int fy, int alpha, uint8_t* dst)
+{
+    int pixel [4];
+    for (int c = 0; c < 4; ++c)
+    {
+        const auto left  = (row0 [c] * (256 - fy) + row1 [c] * fy + 128) >> 8;
+        const auto right = (row0 [c + 4] * (256 - fy) + row1 [c + 4] * fy + 128) >> 8;
+        pixel [c] = ((((left * (256 - fx) + right * fx + 128) >> 8) * alpha) + 128) >> 8;
+    }
+
+    blendScalar (dst, pixel);
+}
+
+#if FOLEYS_COMPOSITOR_SSE2
+static inline void bilinearBlend (const uint8_t* row0, const uint8_t* row1, int fx, int fy, int alpha, uint8_t* dst)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto half = _mm_set1_epi16 (128);
+
+    // both rows with two pixels each, widened to 16 bit
+    const auto r0 = _mm_unpacklo_epi8 (_mm_loadl_epi64 (reinterpret_cast<const __m128i*> (row0)), zero);
+    const auto r1 = _mm_unpacklo_epi8 (_mm_loadl_epi64 (reinterpret_cast<const __m128i*> (row1)), zero);
+
+    auto v = _mm_add_epi16 (_mm_mullo_epi16 (r0, _mm_set1_epi16 (short (256 - fy))),
+                            _mm_mullo_epi16 (r1, _mm_set1_epi16 (short (fy))));
+    v = _mm_srli_epi16 (_mm_add_epi16 (v, half), 8);
+
+    const auto wx = _mm_set_epi16 (short (fx), short (fx), short (fx), short (fx),
+                                   short (256 - fx), short (256 - fx), short (256 - fx), short (256 - fx));
+    v = _mm_mullo_epi16 (v, wx);
+    v = _mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (v, _mm_srli_si128 (v, 8)), half), 8);
+    v = _mm_srli_epi16 (_mm_add_epi16 (_mm_mullo_epi16 (v, _mm_set1_epi16 (short (alpha))), half), 8);
+
+    const auto a = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (alphaIndex, alphaIndex, alphaIndex, alphaIndex));
+    const auto inverse = _mm_sub_epi16 (_mm_set1_epi16 (256), a);
+
+    auto d = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (int (readPixel (dst))), zero);
+    d = _mm_srli_epi16 (_mm_add_epi16 (_mm_mullo_epi16 (d, inverse), half), 8);
+
+    writePixel (dst, uint32_t (_mm_cvtsi128_si32 (_mm_packus_epi16 (_mm_add_epi16 (v, d), zero))));
+}
+
+/** Blends four source pixels with the opacity over four destination pixels */
+static inline void blendFour (const uint8_t* src, int alpha, uint8_t* dst)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto s = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (src));
+    const auto d = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (dst));
+    const auto factor = _mm_set1_epi16 (short (alpha));
+    const auto full = _mm_set1_epi16 (256);
+    const auto half = _mm_set1_epi16 (128);
+
+    auto blendHalf = [&](__m128i sh, __m128i dh)
+    {
+        sh = _mm_srli_epi16 (_mm_add_epi16 (_mm_mullo_epi16 (sh, factor), half), 8);
+        auto a = _mm_shufflelo_epi16 (sh, _MM_SHUFFLE (alphaIndex, alphaIndex, alphaIndex, alphaIndex));
+        a = _mm_shufflehi_epi16 (a, _MM_SHUFFLE (alphaIndex, alphaIndex, alphaIndex, alphaIndex));
+        dh = _mm_srli_epi16 (_mm_add_epi16 (_mm_mullo_epi16 (dh, _mm_sub_epi16 (full, a)), half), 8);
+        return _mm_add_epi16 (sh, dh);
+    };
+
+    const auto lo = blendHalf (_mm_unpacklo_epi8 (s, zero), _mm_unpacklo_epi8 (d, zero));
+    const auto hi = blendHalf (_mm_unpackhi_epi8 (s, zero), _mm_unpackhi_epi8 (d, zero));
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst), _mm_packus_epi16 (lo, hi));
+}
+#elif FOLEYS_COMPOSITOR_NEON
+static inline void bilinearBlend (const uint8_t* row0, const uint8_t* row1, int fx, int fy, int alpha, uint8_t* dst)
+{
+    const auto r0 = vmovl_u8 (vld1_u8 (row0));
+    const auto r1 = vmovl_u8 (vld1_u8 (row1));
+
+    const auto v = vrshrq_n_u16 (vmlaq_n_u16 (vmulq_n_u16 (r0, uint16_t (256 - fy)), r1, uint16_t (fy)), 8);
+
+    auto p = vrshr_n_u16 (vmla_n_u16 (vmul_n_u16 (vget_low_u16 (v), uint16_t (256 - fx)), vget_high_u16 (v), uint16_t (fx)), 8);
+    p = vrshr_n_u16 (vmul_n_u16 (p, uint16_t (alpha)), 8);
+
+    const auto inverse = vsub_u16 (vdup_n_u16 (256), vdup_lane_u16 (p, alphaIndex));
+
+    uint32_t target = readPixel (dst);
+    auto d = vget_low_u16 (vmovl_u8 (vreinterpret_u8_u32 (vdup_n_u32 (target))));
+    d = vrshr_n_u16 (vmul_u16 (d, inverse), 8);
+
+    const auto result = vqmovn_u16 (vcombine_u16 (vadd_u16 (p, d), vdup_n_u16 (0)));
+    writePixel (dst, vget_lane_u32 (vreinterpret_u32_u8 (result), 0));
+}
+
+static inline void blendFour (const uint8_t* src, int alpha, uint8_t* dst)
+{
+    const auto s = vld1q_u8 (src);
+    const auto d = vld1q_u8 (dst);
+
+    auto blendHalf = [alpha](uint16x8_t sh, uint16x8_t dh)
+    {
+        sh = vrshrq_n_u16 (vmulq_n_u16 (sh, uint16_t (alpha)), 8);
+        const auto a = vcombine_u16 (vdup_lane_u16 (vget_low_u16 (sh), alphaIndex),
+                                     vdup_lane_u16 (vget_high_u16 (sh), alphaIndex));
+        dh = vrshrq_n_u16 (vmulq_u16 (dh, vsubq_u16 (vdupq_n_u16 (256), a)), 8);
+        return vaddq_u16 (sh, dh);
+    };
+
+    const auto lo = blendHalf (vmovl_u8 (vget_low_u8 (s)),  vmovl_u8 (vget_low_u8 (d)));
+    const auto hi = blendHalf (vmovl_u8 (vget_high_u8 (s)), vmovl_u8 (vget_high_u8 (d)));
+    vst1q_u8 (dst, vcombine_u8 (vqmovn_u16 (lo), vqmovn_u16 (hi)));
+}
+#else
+static inline void bilinearBlend (const uint8_t* row0, const uint8_t* row1, int fx, int fy, int alpha, uint8_t* dst)
+{
+    bilinearBlendScalar (row0, row1, fx, fy, alpha, dst);
+}
+
+static inline void blendFour (const uint8_t* src, int alpha, uint8_t* dst)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        int pixel [4];
+        for (int c = 0; c < 4; ++c)
+            pixel [c] = (src [i * 4 + c] * alpha + 128) >> 8;
+
+        blendScalar (dst + i * 4, pixel);
+    }
+}
+#endif
+
+/** Reads the four neighbours of a sample position at the border, outside pixels are transparent */
+static inline void gatherBorder (const Bitmap& source, int ix, int iy, uint8_t* neighbours)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto x = ix + (i & 1);
+        const auto y = iy + (i >> 1);
+        const auto inside = x >= 0 && y >= 0 && x < source.width && y < source.height;
+        writePixel (neighbours + i * 4, inside ? readPixel (source.getPixel (x, y)) : 0);
+    }
+}
+
+/**
+ Composites one row of target pixels from x0 to x1. The sample positions are in 16.16 fixed point
+ and already moved by half a pixel, so the integer part is the top left neighbour.
+ */
+static void compositeRowBilinear (const Bitmap& target, const Bitmap& source, int y, int x0, int x1,
+                                  int64_t sx, int64_t sy, int64_t dx, int64_t dy, int alpha)
+{
+    auto* dst = target.getPixel (x0, y);
+    uint8_t neighbours [16];
+
+    for (int x = x0; x < x1; ++x, sx += dx, sy += dy, dst += 4)
+    {
+        const auto ix = int (sx >> 16);
+        const auto iy = int (sy >> 16);
+
+        if (ix < -1 || iy < -1 || ix >= source.width || iy >= source.height)
+            continue;
+
+        const auto fx = int ((sx >> 8) & 0xff);
+        const auto fy = int ((sy >> 8) & 0xff);
+
+        if (ix >= 0 && iy >= 0 && ix < source.width - 1 && iy < source.height - 1)
+        {
+            const auto* p = source.getPixel (ix, iy);
+            bilinearBlend (p, p + source.lineStride, fx, fy, alpha, dst);
+        }
+        else
+        {
+            gatherBorder (source, ix, iy, neighbours);
+            bilinearBlend (neighbours, neighbours + 8, fx, fy, alpha, dst);
+        }
+    }
+}
+
+static inline float cubicWeight (float t)
+{
+    // Catmull-Rom
+    t = std::abs (t);
+    if (t < 1.0f)
+        return 1.5f * t * t * t - 2.5f * t * t + 1.0f;
+    if (t < 2.0f)
+        return -0.5f * t * t * t + 2.5f * t * t - 4.0f * t + 2.0f;
+    return 0.0f;
+}
+
+static void compositeRowBicubic (const Bitmap& target, const Bitmap& source, int y, int x0, int x1,
+                                 double sx, double sy, double dx, double dy, int alpha)
+{
+    auto* dst = target.getPixel (x0, y);
+
+    for (int x = x0; x < x1; ++x, sx += dx, sy += dy, dst += 4)
+    {
+        const auto ix = int (std::floor (sx));
+        const auto iy = int (std::floor (sy));
+
+        if (ix < -2 || iy < -2 || ix > source.width || iy > source.height)
+            continue;
+
+        float wx [4], wy [4];
+        for (int i = 0; i < 4; ++i)
+        {
+            wx [i] = cubicWeight (float (sx - (ix - 1 + i)));
+            wy [i] = cubicWeight (float (sy - (iy - 1 + i)));
+        }
+
+        float sum [4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int j = 0; j < 4; ++j)
+        {
+            const auto py = iy - 1 + j;
+            if (py < 0 || py >= source.height)
+                continue;
+
+            for (int i = 0; i < 4; ++i)
+            {
+                const auto px = ix - 1 + i;
+                if (px < 0 || px >= source.width)
+                    continue;
+
+                const auto* p = source.getPixel (px, py);
+                const auto w = wx [i] * wy [j];
+                for (int c = 0; c < 4; ++c)
+                    sum [c] += p [c] * w;
+            }
+        }
+
+        // keep the result a valid premultiplied colour
+        int pixel [4];
+        const auto a = juce::jlimit (0.0f, 255.0f, sum [alphaIndex]);
+        for (int c = 0; c < 4; ++c)
+            pixel [c] = (int (juce::jlimit (0.0f, a, sum [c]) + 0.5f) * alpha + 128) >> 8;
+
+        blendScalar (dst, pixel);
+    }
+}
+
+/** Blends a row without resampling, e.g. for a source placed on whole pixels */
+static void compositeRowCopy (uint8_t* dst, const uint8_t* src, int numPixels, int alpha)
+{
+    int x = 0;
+
+    if (alpha >= 256)
+    {
+        // opaque pixels are simply copied, which is the common case for video
+        for (; x + 4 <= numPixels; x += 4)
+        {
+            if (src [x * 4 + alphaIndex] == 255 && src [x * 4 + 4 + alphaIndex] == 255
+                && src [x * 4 + 8 + alphaIndex] == 255 && src [x * 4 + 12 + alphaIndex] == 255)
+                std::memcpy (dst + x * 4, src + x * 4, 16);
+            else
+                blendFour (src + x * 4, alpha, dst + x * 4);
+        }
+    }
+    else
+    {
+        for (; x + 4 <= numPixels; x += 4)
+            blendFour (src + x * 4, alpha, dst + x * 4);
+    }
+
+    for (; x < numPixels; ++x)
+    {
+        int pixel [4];
+        for (int c = 0; c < 4; ++c)
+            pixel [c] = (src [x * 4 + c] * alpha + 128) >> 8;
+
+        blendScalar (dst + x * 4, pixel);
+    }
+}
+
+/** Limits the pixels of a row to those, where start + delta * x lies within the range */
+static void clipSpan (double start, double delta, double low, double high, int& begin, int& end)
+{
+    if (std::abs (delta) < 1.0e-9)
+    {
+        if (start < low || start >= high)
+            end = begin;
+
+        return;
+    }
+
+    auto first = (low - start) / delta;
+    auto last  = (high - start) / delta;
+    if (first > last)
+        std::swap (first, last);
+
+    // one pixel margin, the kernels check each pixel anyway
+    begin = int (std::max (double (begin), std::floor (first) - 1.0));
+    end   = int (std::min (double (end),   std::ceil (last) + 1.0));
+}
+
+//==============================================================================
+
+static Bitmap makeBitmap (const juce::Image::BitmapData& data)
+{
+    jassert (data.pixelStride == 4);
+    return { data.data, data.width, data.height, data.lineStride };
+}
+
+/** Returns the part of the area, where the transformed source can change the target */
+static juce::Rectangle<int> getAffectedArea (juce::Rectangle<int> area, const juce::Image& target,
+                                             const juce::Image& source, const juce::AffineTransform& transform)
+{
+    area = area.isEmpty() ? target.getBounds() : area.getIntersection (target.getBounds());
+    return area.getIntersection (source.getBounds().toFloat().transformedBy (transform).getSmallestIntegerContainer().expanded (1));
+}
+
+/** Returns true, if the transform places the source on whole pixels without scaling */
+static bool isIntegerTranslation (const juce::AffineTransform& transform, int& tx, int& ty)
+{
+    tx = juce::roundToInt (transform.mat02);
+    ty = juce::roundToInt (transform.mat12);
+    return transform.mat00 == 1.0f && transform.mat11 == 1.0f && transform.mat01 == 0.0f && transform.mat10 == 0.0f
+        && std::abs (transform.mat02 - float (tx)) < 1.0e-3f && std::abs (transform.mat12 - float (ty)) < 1.0e-3f;
+}
+
+/**
+ Composites the source into the area of the target. Each row is computed independently of
+ the area, so splitting the target into bands produces the same pixels.
+ */
+static void composite (const Bitmap& dst, const Bitmap& src, const juce::AffineTransform& transform,
+                       int opacity, Compositor::Sampling sampling, juce::Rectangle<int> area)
+{
+    // a source placed on whole pixels needs no resampling
+    int tx = 0, ty = 0;
+    if (isIntegerTranslation (transform, tx, ty))
+    {
+        const auto placed = area.getIntersection ({ tx, ty, src.width, src.height });
+        for (int y = placed.getY(); y < placed.getBottom(); ++y)
+            compositeRowCopy (dst.getPixel (placed.getX(), y),
+                              src.getPixel (placed.getX() - tx, y - ty),
+                              placed.getWidth(), opacity);
+        return;
+    }
+
+    const auto inverse = transform.inverted();
+    const auto dx = double (inverse.mat00);
+    const auto dy = double (inverse.mat10);
+
+    // sample positions outside this range don't touch the source
+    const auto margin = sampling == Compositor::Sampling::bicubic ? 2.0 : 1.0;
+
+    for (int y = area.getY(); y < area.getBottom(); ++y)
+    {
+        const auto cx = area.getX() + 0.5;
+        const auto cy = y + 0.5;
+        const auto sx = inverse.mat00 * cx + inverse.mat01 * cy + inverse.mat02 - 0.5;
+        const auto sy = inverse.mat10 * cx + inverse.mat11 * cy + inverse.mat12 - 0.5;
+
+        auto begin = 0;
+        auto end   = area.getWidth();
+        clipSpan (sx, dx, -margin, src.width + margin - 1.0, begin, end);
+        clipSpan (sy, dy, -margin, src.height + margin - 1.0, begin, end);
+
+        if (begin >= end)
+            continue;
+
+        const auto startX = sx + begin * dx;
+        const auto startY = sy + begin * dy;
+
+        if (sampling == Compositor::Sampling::bicubic)
+            compositeRowBicubic (dst, src, y, area.getX() + begin, area.getX() + end,
+                                 startX, startY, dx, dy, opacity);
+        else
+            compositeRowBilinear (dst, src, y, area.getX() + begin, area.getX() + end,
+                                  std::llround (startX * 65536.0), std::llround (startY * 65536.0),
+                                  std::llround (dx * 65536.0), std::llround (dy * 65536.0), opacity);
+    }
+}
+
+static int getOpacity (float alpha)
+{
+    return juce::jlimit (0, 256, juce::roundToInt (alpha * 256.0f));
+}
+
+/** Composites all layers into one band of rows of the target */
+class BandJob : public WorkerPool::Job
+{
+public:
+    BandJob (const Bitmap& targetToUse, const std::vector<Bitmap>& sourcesToUse,
+             const Compositor::LayerList& layersToUse, const std::vector<juce::Rectangle<int>>& areasToUse, int numBandsToUse)
+      : target (targetToUse), sources (sourcesToUse), layers (layersToUse), areas (areasToUse), numBands (numBandsToUse)
+    {
+    }
+
+    void runTask (int band) override
+    {
+        const auto top    = target.height * band / numBands;
+        const auto bottom = target.height * (band + 1) / numBands;
+
+        // every layer in order, so each pixel sees the same sequence of blends
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            const auto area = areas [i].getIntersection ({ 0, top, target.width, bottom - top });
+            if (! area.isEmpty())
+                composite (target, sources [i], layers [i].transform, getOpacity (layers [i].alpha), layers [i].sampling, area);
+        }
+    }
+
+private:
+    const Bitmap&                             target;
+    const std::vector<Bitmap>&                sources;
+    const Compositor::LayerList&              layers;
+    const std::vector<juce::Rectangle<int>>&  areas;
+    const int                                 numBands;
+};
+
+} // CompositorKernels
+
+//==============================================================================
+
+void Compositor::drawImage (juce::Image& target,
+                            const juce::Image& sourceImage,
+                            const juce::AffineTransform& transform,
+                            float alpha,
+                            Sampling sampling,
+                            juce::Rectangle<int> area)
+{
+    if (target.isNull() || sourceImage.isNull() || alpha <= 0.0f || transform.isSingularity())
+        return;
+
+    area = CompositorKernels::getAffectedArea (area, target, sourceImage, transform);
+    if (area.isEmpty())
+        return;
+
+    if (target.getFormat() != juce::Image::ARGB)
+    {
+        juce::Graphics g (target);
+        g.reduceClipRegion (area);
+        g.setOpacity (alpha);
+        g.drawImageTransformed (sourceImage, transform);
+        return;
+    }
+
+    const auto source = sourceImage.convertedToFormat (juce::Image::ARGB);
+    const juce::Image::BitmapData sourceData (source, juce::Image::BitmapData::readOnly);
+    const juce::Image::BitmapData targetData (target, juce::Image::BitmapData::readWrite);
+
+    CompositorKernels::composite (CompositorKernels::makeBitmap (targetData), CompositorKernels::makeBitmap (sourceData),
+                                  transform, CompositorKernels::getOpacity (alpha), sampling, area);
+}
+
+void Compositor::drawLayers (juce::Image& target, const LayerList& layers, WorkerPool* pool)
+{
+    if (target.isNull() || layers.empty())
+        return;
+
+    // walk from the top and skip layers hidden under the opaque layers above
+    std::vector<juce::Rectangle<int>> covered;
+    std::vector<const Layer*> visibleLayers;
+
+    for (auto layer = layers.rbegin(); layer != layers.rend(); ++layer)
+    {
+        if (layer->image.isNull() || layer->alpha <= 0.0f || layer->transform.isSingularity())
+            continue;
+
+        const auto size = Size { layer->image.getWidth(), layer->image.getHeight() };
+        const auto bounds = getLayerBounds (size, layer->transform).getIntersection (target.getBounds());
+
+        if (bounds.isEmpty() || std::any_of (covered.begin(), covered.end(), [&bounds](const auto& c) { return c.contains (bounds); }))
+            continue;
+
+        if (layer->opaque && layer->alpha >= 1.0f)
+            covered.push_back (getCoveredBounds (size, layer->transform, layer->sampling));
+
+        visibleLayers.insert (visibleLayers.begin(), &*layer);
+    }
+
+    if (target.getFormat() != juce::Image::ARGB || pool == nullptr || visibleLayers.size() * size_t (target.getHeight()) < 256)
+    {
+        for (const auto* layer : visibleLayers)
+            drawImage (target, layer->image, layer->transform, layer->alpha, layer->sampling);
+
+        return;
+    }
+
+    LayerList visible;
+    visible.reserve (visibleLayers.size());
+    for (const auto* layer : visibleLayers)
+        visible.push_back ({ layer->image.convertedToFormat (juce::Image::ARGB), layer->transform, layer->alpha, layer->sampling, layer->opaque });
+
+    // the bitmaps are accessed once here, the bands only use the raw pixels
+    std::vector<std::unique_ptr<juce::Image::BitmapData>> sourceData;
+    std::vector<CompositorKernels::Bitmap> sources;
+    std::vector<juce::Rectangle<int>> areas;
+
+    for (const auto& layer : visible)
+    {
+        sourceData.push_back (std::make_unique<juce::Image::BitmapData> (layer.image, juce::Image::BitmapData::readOnly));
+        sources.push_back (CompositorKernels::makeBitmap (*sourceData.back()));
+        areas.push_back (CompositorKernels::getAffectedArea ({}, target, layer.image, layer.transform));
+    }
+
+    const juce::Image::BitmapData targetData (target, juce::Image::BitmapData::readWrite);
+    const auto bitmap = CompositorKernels::makeBitmap (targetData);
+
+    // more bands than threads to balance layers covering only parts of the frame
+    const auto numBands = juce::jlimit (1, std::max (1, target.getHeight() / 16), (pool->getNumThreads() + 1) * 4);
+
+    CompositorKernels::BandJob job (bitmap, sources, visible, areas, numBands);
+    pool->run (job, numBands);
+}
+
+juce::Rectangle<int> Compositor::getLayerBounds (Size imageSize, const juce::AffineTransform& transform)
+{
+    // the same margin the drawing uses for the interpolated edge
+    return juce::Rectangle<float> (float (imageSize.width), float (imageSize.height))
+               .transformedBy (transform).getSmallestIntegerContainer().expanded (1);
+}
+
+juce::Rectangle<int> Compositor::getCoveredBounds (Size imageSize, const juce::AffineTransform& transform, Sampling sampling)
+{
+    int tx = 0, ty = 0;
+    if (CompositorKernels::isIntegerTranslation (transform, tx, ty))
+        return { tx, ty, imageSize.width, imageSize.height };
+
+    if (transform.mat01 != 0.0f || transform.mat10 != 0.0f || transform.mat00 <= 0.0f || transform.mat11 <= 0.0f)
+        return {};
+
+    // a pixel is covered, if all source pixels its centre is interpolated from are inside the image,
+    // the inset has some margin for rounding the fixed point positions
+    const auto inset = sampling == Sampling::bicubic ? 2.0f : 1.0f;
+    const auto inner = juce::Rectangle<float> (float (imageSize.width), float (imageSize.height))
+                           .reduced (inset).transformedBy (transform);
+
+    const auto left   = int (std::ceil (inner.getX() - 0.5f));
+    const auto top    = int (std::ceil (inner.getY() - 0.5f));
+    const auto right  = int (std::floor (inner.getRight() - 0.5f)) + 1;
+    const auto bottom = int (std::floor (inner.getBottom() - 0.5f)) + 1;
+
+    return juce::Rectangle<int>::leftTopRightBottom (left, top, std::max (left, right), std::max (top, bottom));
+}
+
+juce::AffineTransform Compositor::getFrameTransform (Size frameSize, juce::Rectangle<float> area, Aspect aspect,
+                                                     float rotation, float zoom, juce::Point<float> translation)
+{
+    juce::AffineTransform transformation;
+
+    if (frameSize.width <= 0 || frameSize.height <= 0)
+        return transformation;
+
+    const auto factorX = area.getWidth() / frameSize.width;
+    const auto factorY = area.getHeight() / frameSize.height;
+
+    juce::Point<float> offset;
+
+    if (aspect == Aspect::LetterBox || aspect == Aspect::Crop)
+    {
+        const auto factor = aspect == Aspect::LetterBox ? std::min (factorX, factorY) : std::max (factorX, factorY);
+        transformation = transformation.scale (factor);
+        offset.setXY ((area.getWidth() - frameSize.width * factor) * 0.5f,
+                      (area.getHeight() - frameSize.height * factor) * 0.5f);
+    }
+    else if (aspect == Aspect::ZoomScale)
+    {
+        transformation = transformation.scale (factorX, factorY);
+    }
+
+    return transformation.translated (area.getX(), area.getY())
+                         .rotated (juce::degreesToRadians (rotation), area.getCentreX(), area.getCentreY())
+                         .scaled (zoom * 0.01f, zoom * 0.01f, area.getCentreX(), area.getCentreY())
+                         .translated (area.getWidth() * translation.x, area.getHeight() * translation.y)
+                         .translated (offset.roundToInt().toFloat());
+}
+
+juce::String Compositor::getKernelName()
+{
+#if FOLEYS_COMPOSITOR_SSE2
+    return "SSE2";
+#elif FOLEYS_COMPOSITOR_NEON
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+} // foleys
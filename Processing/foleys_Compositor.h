@@ -0,0 +1,102 @@
+/*
+ ==============================================================================
+
+ Copyright (c) 2019 - 2021, Foleys Finest Audio - Daniel Walz
+ All rights reserved.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace foleys
+{
+
+/**
+ @class Compositor
+
+ The Compositor draws video frames onto each other. Unlike juce::Graphics it only
+ supports what a video compositor needs: premultiplied ARGB images, an affine transform
+ and an opacity. The blend kernels are vectorised using SSE2 or NEON where available,
+ with a scalar fallback producing the same results.
+ */
+class Compositor final
+{
+public:
+    enum class Sampling
+    {
+        bilinear,   /**< Fast interpolation of the four neighbours, used for playback */
+        bicubic     /**< Catmull-Rom interpolation of 16 neighbours, sharper when scaling up */
+    };
+
+    /**
+     Draws the source image over the target.
+     @param target the image to draw into. It should be ARGB, otherwise juce::Graphics is used
+     @param source the image to draw, other formats than ARGB are converted first
+     @param transform maps source pixels to target pixels
+     @param alpha the opacity of the source
+     @param sampling the interpolation used, if the source isn't placed on whole pixels
+     @param area limits drawing to that part of the target. An empty area draws the whole target
+     */
+    static void drawImage (juce::Image& target,
+                           const juce::Image& source,
+                           const juce::AffineTransform& transform,
+                           float alpha = 1.0f,
+                           Sampling sampling = Sampling::bilinear,
+                           juce::Rectangle<int> area = {});
+
+    /** A transformed image to draw in Compositor::drawLayers() */
+    struct Layer
+    {
+        juce::Image           image;
+        juce::AffineTransform transform;
+        float                 alpha    = 1.0f;
+        Sampling              sampling = Sampling::bilinear;
+
+        /** Set this, if every pixel of the image is opaque, so layers below can be skipped */
+        bool                  opaque   = false;
+    };
+
+    using LayerList = std::vector<Layer>;
+
+    /**
+     Draws the layers in order over the target. With a WorkerPool the target is split into
+     bands of rows, that are composited in parallel. Each pixel is still blended by one thread
+     in layer order, so the result is the same as drawing the layers one after another.
+     Layers completely covered by an opaque layer above are skipped.
+     */
+    static void drawLayers (juce::Image& target, const LayerList& layers, WorkerPool* pool = nullptr);
+
+    /**
+     Returns the transform, that fits an image of the given size into the area keeping the aspect ratio,
+     and applies zoom, translation and rotation like in AVClip::renderFrame().
+     */
+    static juce::AffineTransform getFrameTransform (Size frameSize, juce::Rectangle<float> area, Aspect aspect,
+                                                    float rotation, float zoom, juce::Point<float> translation);
+
+    /** Returns the pixels of the target, that an image of that size drawn with the transform can change */
+    static juce::Rectangle<int> getLayerBounds (Size imageSize, const juce::AffineTransform& transform);
+
+    /**
+     Returns the pixels of the target, that an opaque image of that size drawn with the transform
+     covers completely, so nothing below shows through. This is empty for rotated images.
+     */
+    static juce::Rectangle<int> getCoveredBounds (Size imageSize, const juce::AffineTransform& transform,
+                                                  Sampling sampling = Sampling::bilinear);
+
+    /** Returns the name of the kernels compiled into this build, e.g. "SSE2" */
+    static juce::String getKernelName();
+};
+
+} // foleys
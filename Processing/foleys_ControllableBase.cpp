@@ -26,6 +26,50 @@ ControllableBase::ControllableBase (TimeCodeAware& reference)
 {
 }
 
+int ControllableBase::getParameterHandle (const juce::Identifier& paramID)
+{
+    int handle = 0;
+    for (const auto& parameter : getParameters())
+    {
+        if (parameter.first == paramID)
+            return handle;
+
+        ++handle;
+    }
+
+    return -1;
+}
+
+ParameterAutomation* ControllableBase::getParameter (int handle) const
+{
+    if (juce::isPositiveAndBelow (handle, parameterList.size()))
+        return parameterList [size_t (handle)];
+
+    return nullptr;
+}
+
+double ControllableBase::getHandleValueAtTime (int handle, double pts, double defaultValue) const
+{
+    if (auto* parameter = getParameter (handle))
+        return parameter->getRealValueForTime (pts);
+
+    return defaultValue;
+}
+
+void ControllableBase::updateParameterHandles()
+{
+    // the handles are the positions in the AutomationMap
+    parameterList.clear();
+    for (const auto& parameter : getParameters())
+        parameterList.push_back (parameter.second.get());
+}
+
+void ControllableBase::applyPendingUpdates()
+{
+    for (auto* parameter : parameterList)
+        parameter->applyPendingReload();
+}
+
 void ControllableBase::notifyParameterAutomationChange (const ParameterAutomation* p)
 {
     listeners.call ([p](auto& l) { l.parameterAutomationChanged (p); });
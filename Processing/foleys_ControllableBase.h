@@ -41,6 +41,22 @@ public:
 
     virtual ~ControllableBase() = default;
 
+    /**
+     Audio automation is evaluated on an absolute grid of this many samples. Between
+     the grid points the values are interpolated or held, so the audio doesn't depend
+     on the block size. It is also the minimum size of the blocks an AudioProcessor
+     is split into.
+     */
+    static constexpr int automationGridSize = 32;
+
+    /** Returns the start of the grid cell containing the sample position */
+    static int64_t getAutomationGridStart (int64_t position)
+    {
+        const auto grid = int64_t (automationGridSize);
+        return position >= 0 ? position - position % grid
+                             : position - ((position % grid) + grid) % grid;
+    }
+
     /**
      Since the automation values are time dependent, every instance, that inherits
      ControllableBase needs a way to tell the local time (presentation time stamp).
@@ -66,6 +82,32 @@ public:
      */
     virtual double getValueAtTime (juce::Identifier paramID, double pts, double defaultValue) = 0;
 
+    /**
+     Returns a handle for the parameter, that can be used in the realtime callbacks instead of
+     looking up the identifier each time. The handle stays valid until the parameters are recreated.
+     Returns -1, if there is no parameter with that identifier.
+     */
+    int getParameterHandle (const juce::Identifier& paramID);
+
+    /** Returns the parameter for the handle or nullptr, if the handle is not valid */
+    ParameterAutomation* getParameter (int handle) const;
+
+    /**
+     Return the value of the parameter at a certain time point, like getValueAtTime() but using
+     a handle from getParameterHandle(). If the handle is not valid, the defaultValue is returned.
+     */
+    double getHandleValueAtTime (int handle, double pts, double defaultValue) const;
+
+    /**
+     Returns true, while changes of the automation state should not be applied immediately,
+     e.g. during a batch edit of the ComposedClip. The changes are applied when
+     applyPendingUpdates() is called.
+     */
+    virtual bool isDeferringUpdates() const { return false; }
+
+    /** Reloads all automations, that changed while the updates were deferred */
+    void applyPendingUpdates();
+
     /**
      The Listener can subscribe to automation changes, e.g. to invalidate existing render, to update UI elements etc.
      */
@@ -96,10 +138,19 @@ public:
     TimeCodeAware& getTimeReference();
     const TimeCodeAware& getTimeReference() const;
 
+protected:
+    /** Call this after creating the parameters to resolve the handles */
+    void updateParameterHandles();
+
+    /** The parameters indexed by their handles, for iterating in the realtime callbacks */
+    const std::vector<ParameterAutomation*>& getParameterList() const { return parameterList; }
+
 private:
     TimeCodeAware&               timeReference;
     juce::ListenerList<Listener> listeners;
 
+    std::vector<ParameterAutomation*> parameterList;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ControllableBase)
 };
 
@@ -18,55 +18,291 @@
  ==============================================================================
  */
 
+
 namespace foleys
 {
 
-void DefaultAudioMixer::setup (int numChannels, double, int samplesPerBlockExpected)
+DefaultAudioMixer::DefaultAudioMixer (WorkerPool* workerPoolToUse)
+  : workerPool (workerPoolToUse)
+{
+}
+
+void DefaultAudioMixer::setup (int numChannels, double sampleRateToUse, int samplesPerBlockExpected)
 {
+    sampleRate = sampleRateToUse;
     mixBuffer.setSize (numChannels, samplesPerBlockExpected);
+
+    const auto numBuffers = workerPool != nullptr ? size_t (maximumParallelClips) : size_t (0);
+    clipBuffers.resize (numBuffers);
+    for (auto& buffer : clipBuffers)
+        buffer.setSize (numChannels, samplesPerBlockExpected);
+
+    gainBuffers.setSize (int (numBuffers) + 1, samplesPerBlockExpected);
+    // a block starting at the last sample of a grid cell touches one more grid point
+    gridBuffers.setSize (int (numBuffers) + 1, (samplesPerBlockExpected + ControllableBase::automationGridSize - 2) / ControllableBase::automationGridSize + 2);
+
+    tasks.clear();
+    tasks.reserve (numBuffers);
+}
+
+void DefaultAudioMixer::setParallelThreshold (int minimumNumClips)
+{
+    parallelThreshold = minimumNumClips;
+}
+
+void DefaultAudioMixer::setMaximumParallelClips (int maximumNumClips)
+{
+    maximumParallelClips = std::max (0, maximumNumClips);
 }
 
 void DefaultAudioMixer::mixAudio (const juce::AudioSourceChannelInfo& info,
                                   const int64_t position,
                                   const double  timeInSeconds,
-                                  const std::vector<std::shared_ptr<ClipDescriptor>>& clips)
+                                  const std::vector<std::shared_ptr<ClipDescriptor>>& clips,
+                                  const std::vector<std::shared_ptr<AudioBus>>& buses)
 {
-    for (auto& clip : clips)
+    mixAudioWithStems (info, position, timeInSeconds, clips, buses, noStems);
+}
+
+void DefaultAudioMixer::mixAudioWithStems (const juce::AudioSourceChannelInfo& info,
+                                           const int64_t position,
+                                           const double  timeInSeconds,
+                                           const std::vector<std::shared_ptr<ClipDescriptor>>& clips,
+                                           const std::vector<std::shared_ptr<AudioBus>>& buses,
+                                           std::vector<juce::AudioBuffer<float>>& stems)
+{
+    // the buffers were allocated in setup() with a smaller block size
+    jassert (info.numSamples <= mixBuffer.getNumSamples());
+
+    blockPosition   = position;
+    blockTime       = timeInSeconds;
+    blockNumSamples = info.numSamples;
+
+    stemOutputs = &stems;
+    for (auto& stem : stems)
+    {
+        jassert (info.numSamples <= stem.getNumSamples());
+        stem.clear (0, info.numSamples);
+    }
+
+    for (const auto& bus : buses)
+    {
+        // the bus was not prepared, this happens if you call mixAudio without ComposedClip::prepareToPlay()
+        jassert (info.numSamples <= bus->getBuffer().getNumSamples());
+        bus->getBuffer().clear (0, info.numSamples);
+    }
+
+    tasks.clear();
+    auto clip = clips.begin();
+
+    for (; clip != clips.end() && tasks.size() < clipBuffers.size(); ++clip)
+    {
+        const auto& descriptor = *clip;
+        if (isAudibleInBlock (*descriptor) && ! descriptor->isWaitingForDecoder())
+            tasks.push_back (createTask (*descriptor, buses));
+    }
+
+    if (workerPool != nullptr && ! tasks.empty() && int (tasks.size()) >= parallelThreshold)
     {
-        const auto start = clip->getStartInSamples();
-        if (position + info.numSamples >= start && position < start + clip->getLengthInSamples())
+        workerPool->run (*this, int (tasks.size()));
+
+        for (size_t i = 0; i < tasks.size(); ++i)
+            addClipToOutput (tasks [i], clipBuffers [i], info);
+    }
+    else
+    {
+        for (auto& task : tasks)
         {
-            clip->updateAudioAutomations (timeInSeconds - clip->getStart());
-
-            const auto offset = std::max (int (start - position), 0);
-            juce::AudioSourceChannelInfo reader (&mixBuffer, 0, info.numSamples - offset);
-            clip->clip->getNextAudioBlock (reader);
-
-            if (clip->getAudioPlaying() == false || offset > info.numSamples)
-                continue;
-
-            juce::AudioBuffer<float> procBuffer (mixBuffer.getArrayOfWritePointers(), mixBuffer.getNumChannels(), 0, info.numSamples - offset);
-            juce::MidiBuffer midiDummy;
-            for (const auto& controller : clip->getAudioProcessors())
-            {
-                controller->updateAutomation ((timeInSeconds - clip->getStart()) + clip->getOffset());
-                if (auto* audioProcessor = controller->getAudioProcessor())
-                {
-                    if (audioProcessor->isSuspended() == false)
-                    {
-                        controller->setPosition (position - start, timeInSeconds);
-                        if (controller->isActive())
-                            audioProcessor->processBlock (procBuffer, midiDummy);
-                        else
-                            audioProcessor->processBlockBypassed (procBuffer, midiDummy);
-                    }
-                }
-            }
-
-            for (int channel = 0; channel < mixBuffer.getNumChannels(); ++channel)
-                info.buffer->addFrom (channel, info.startSample + offset, mixBuffer.getReadPointer (channel), info.numSamples - offset);
+            processClip (task, mixBuffer, int (clipBuffers.size()));
+            addClipToOutput (task, mixBuffer, info);
         }
     }
+
+    // clips exceeding the number of parallel buffers
+    for (; clip != clips.end(); ++clip)
+    {
+        const auto& descriptor = *clip;
+        if (isAudibleInBlock (*descriptor) && ! descriptor->isWaitingForDecoder())
+        {
+            auto task = createTask (*descriptor, buses);
+            processClip (task, mixBuffer, int (clipBuffers.size()));
+            addClipToOutput (task, mixBuffer, info);
+        }
+    }
+
+    // clips continuing the decoder of a clip, that rendered up to the cut above, in the order of their cuts
+    for (;;)
+    {
+        ClipDescriptor* next = nullptr;
+        for (const auto& descriptor : clips)
+            if (descriptor->isWaitingForDecoder() && isAudibleInBlock (*descriptor)
+                && (next == nullptr || descriptor->getStartInSamples() < next->getStartInSamples()))
+                next = descriptor.get();
+
+        if (next == nullptr)
+            break;
+
+        next->takeOverDecoder();
+
+        auto task = createTask (*next, buses);
+        processClip (task, mixBuffer, int (clipBuffers.size()));
+        addClipToOutput (task, mixBuffer, info);
+    }
+
+    for (const auto& bus : buses)
+    {
+        bus->processBlock (info.numSamples, position);
+
+        const auto& busBuffer = bus->getBuffer();
+        for (int channel = 0; channel < std::min (busBuffer.getNumChannels(), info.buffer->getNumChannels()); ++channel)
+            info.buffer->addFrom (channel, info.startSample, busBuffer.getReadPointer (channel), info.numSamples);
+
+        addToStem (bus->getAudioStemIndex(), 0, busBuffer, info.numSamples);
+    }
+
+    stemOutputs = &noStems;
+}
+
+DefaultAudioMixer::ClipTask DefaultAudioMixer::createTask (ClipDescriptor& clip, const std::vector<std::shared_ptr<AudioBus>>& buses) const
+{
+    // the index is resolved when the buses are published, it can be ahead of the buses list for one block
+    const auto busIndex = clip.getAudioBusIndex();
+    auto* bus = juce::isPositiveAndBelow (busIndex, buses.size()) ? buses [size_t (busIndex)].get() : nullptr;
+
+    // a clip ending inside the block, e.g. at a cut, stops there
+    const auto offset = std::max (int (clip.getStartInSamples() - blockPosition), 0);
+    const auto end    = std::min (blockPosition + blockNumSamples, clip.getStartInSamples() + clip.getLengthInSamples());
+
+    return { &clip, bus, offset, std::max (int (end - blockPosition) - offset, 0), false };
+}
+
+bool DefaultAudioMixer::isAudibleInBlock (const ClipDescriptor& clip) const
+{
+    const auto start = clip.getStartInSamples();
+    return clip.clip->hasAudio() && blockPosition + blockNumSamples >= start && blockPosition < start + clip.getLengthInSamples();
+}
+
+void DefaultAudioMixer::runTask (int taskIndex)
+{
+    processClip (tasks [size_t (taskIndex)], clipBuffers [size_t (taskIndex)], taskIndex);
+}
+
+void DefaultAudioMixer::processClip (ClipTask& task, juce::AudioBuffer<float>& buffer, int scratchIndex)
+{
+    auto& clip = *task.clip;
+
+    const auto timeOffset = clip.getOffset() - clip.getStart();
+
+    clip.updateAudioAutomations (blockTime + timeOffset);
+
+    // the gain is applied sample accurate in applyClipGain()
+    clip.clip->setApplyAudioGain (false);
+
+    juce::AudioSourceChannelInfo reader (&buffer, 0, task.numSamples);
+    clip.clip->getNextAudioBlock (reader);
+
+    task.playing = clip.getAudioPlaying() && task.numSamples > 0;
+    if (! task.playing)
+        return;
+
+    const auto position = blockPosition + task.offset;
+
+    juce::AudioBuffer<float> procBuffer (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), 0, task.numSamples);
+    applyClipGain (clip, procBuffer, position, scratchIndex);
+
+    juce::MidiBuffer midiDummy;
+    for (const auto& controller : clip.getAudioProcessors())
+        controller->processAudio (procBuffer, midiDummy, position, sampleRate, clip.getStartInSamples(), timeOffset);
+}
+
+void DefaultAudioMixer::applyClipGain (ClipDescriptor& clip, juce::AudioBuffer<float>& buffer, int64_t position, int scratchIndex)
+{
+    auto* gainAutomation = clip.getAudioGainAutomation();
+    if (gainAutomation == nullptr || sampleRate <= 0)
+        return;
+
+    auto&       automation = *gainAutomation;
+    const auto  timeOffset = clip.getOffset() - clip.getStart();
+    const auto  numSamples = buffer.getNumSamples();
+    const auto  grid = int64_t (ControllableBase::automationGridSize);
+
+    auto* gridGains = gridBuffers.getWritePointer (scratchIndex);
+    auto* gains     = gainBuffers.getWritePointer (scratchIndex);
+
+    // the last samples are interpolated towards the grid point after the block
+    auto cell = ControllableBase::getAutomationGridStart (position);
+    const auto lastPoint = ControllableBase::getAutomationGridStart (position + numSamples - 1) + grid;
+    if (! automation.isChangingBetween (cell / sampleRate + timeOffset, lastPoint / sampleRate + timeOffset))
+    {
+        automation.getRealValuesForTime (cell, grid, sampleRate, timeOffset, gridGains, 1, automation.getPlaybackCursor());
+        buffer.applyGain (juce::Decibels::decibelsToGain (gridGains [0]));
+        return;
+    }
+
+    // the scratch buffers are sized in setup(), blocks longer than expected are processed in parts
+    const auto maxSamples = gainBuffers.getNumSamples();
+    jassert (maxSamples > 0);
+
+    for (int start = 0; start < numSamples && maxSamples > 0; start += maxSamples)
+    {
+        const auto partSamples  = std::min (maxSamples, numSamples - start);
+        const auto partPosition = position + start;
+
+        // read all grid points of this part at once, the gain of each sample only depends on it's absolute position
+        cell = ControllableBase::getAutomationGridStart (partPosition);
+        const auto numPoints = int ((ControllableBase::getAutomationGridStart (partPosition + partSamples - 1) - cell) / grid) + 2;
+        jassert (numPoints <= gridBuffers.getNumSamples());
+
+        automation.getRealValuesForTime (cell, grid, sampleRate, timeOffset, gridGains, numPoints, automation.getPlaybackCursor());
+        for (int point = 0; point < numPoints; ++point)
+            gridGains [point] = juce::Decibels::decibelsToGain (gridGains [point]);
+
+        int sample = 0;
+        for (int point = 0; sample < partSamples; ++point)
+        {
+            const auto startGain = gridGains [point];
+            const auto increment = (gridGains [point + 1] - startGain) / float (grid);
+            const auto endSample = int (std::min (int64_t (partSamples), cell + grid - partPosition));
+
+            for (; sample < endSample; ++sample)
+                gains [sample] = startGain + increment * float (partPosition + sample - cell);
+
+            cell += grid;
+        }
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::multiply (buffer.getWritePointer (channel, start), gains, partSamples);
+    }
+}
+
+void DefaultAudioMixer::addClipToOutput (const ClipTask& task, const juce::AudioBuffer<float>& buffer, const juce::AudioSourceChannelInfo& info)
+{
+    if (! task.playing)
+        return;
+
+    if (task.bus != nullptr)
+    {
+        auto& busBuffer = task.bus->getBuffer();
+        for (int channel = 0; channel < std::min (buffer.getNumChannels(), busBuffer.getNumChannels()); ++channel)
+            busBuffer.addFrom (channel, task.offset, buffer.getReadPointer (channel), task.numSamples);
+
+        return;
+    }
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        info.buffer->addFrom (channel, info.startSample + task.offset, buffer.getReadPointer (channel), task.numSamples);
+
+    addToStem (task.clip->getAudioStemIndex(), task.offset, buffer, task.numSamples);
+}
+
+void DefaultAudioMixer::addToStem (int stemIndex, int offset, const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    if (! juce::isPositiveAndBelow (stemIndex, stemOutputs->size()))
+        return;
+
+    auto& stem = (*stemOutputs) [size_t (stemIndex)];
+    for (int channel = 0; channel < std::min (buffer.getNumChannels(), stem.getNumChannels()); ++channel)
+        stem.addFrom (channel, offset, buffer.getReadPointer (channel), numSamples);
 }
 
 } // foleys
@@ -23,21 +23,90 @@
 namespace foleys
 {
 
-class DefaultAudioMixer : public AudioMixer
+/**
+ The DefaultAudioMixer sums the clips of a ComposedClip. Each clip is read and
+ processed by it's AudioProcessors into a separate buffer. The gain of the clips and
+ the automation of the AudioProcessors are applied sample accurate, so the result
+ doesn't depend on the block size. If a WorkerPool is
+ supplied and enough clips are playing, the clips are processed in parallel.
+ Only the first setMaximumParallelClips() clips (32 by default) get a buffer of their
+ own, any clips beyond that are processed one after the other on the audio thread.
+ The buffers are always summed in the order of the clips, so the result doesn't
+ depend on the threading.
+ Clips routed to an AudioBus are summed into the bus buffer instead. After all clips
+ the buses are processed and added to the output. Clips and buses assigned to a stem
+ are added to the stem as well.
+ */
+class DefaultAudioMixer : public AudioMixer,
+                          private WorkerPool::Job
 {
 public:
-    DefaultAudioMixer() = default;
+    DefaultAudioMixer (WorkerPool* workerPool = nullptr);
 
     void setup (int numChannels, double sampleRate, int samplesPerBlockExpected) override;
 
     void mixAudio (const juce::AudioSourceChannelInfo& info,
                    const int64_t position,
                    const double  timeInSeconds,
-                   const std::vector<std::shared_ptr<ClipDescriptor>>& clips) override;
+                   const std::vector<std::shared_ptr<ClipDescriptor>>& clips,
+                   const std::vector<std::shared_ptr<AudioBus>>& buses) override;
+
+    void mixAudioWithStems (const juce::AudioSourceChannelInfo& info,
+                            const int64_t position,
+                            const double  timeInSeconds,
+                            const std::vector<std::shared_ptr<ClipDescriptor>>& clips,
+                            const std::vector<std::shared_ptr<AudioBus>>& buses,
+                            std::vector<juce::AudioBuffer<float>>& stems) override;
+
+    /** Set the minimum number of playing clips, that are processed in parallel.
+        With fewer clips waking the workers costs more than it saves. */
+    void setParallelThreshold (int minimumNumClips);
+
+    /** Set the maximum number of clips processed in parallel. Any clips above
+        are processed on the audio thread. Call this before setup(). */
+    void setMaximumParallelClips (int maximumNumClips);
 
 private:
+    struct ClipTask
+    {
+        ClipDescriptor* clip = nullptr;
+        AudioBus*       bus = nullptr;
+        int             offset = 0;
+        int             numSamples = 0;
+        bool            playing = false;
+    };
+
+    void runTask (int taskIndex) override;
+
+    ClipTask createTask (ClipDescriptor& clip, const std::vector<std::shared_ptr<AudioBus>>& buses) const;
+    bool isAudibleInBlock (const ClipDescriptor& clip) const;
+    void processClip (ClipTask& task, juce::AudioBuffer<float>& buffer, int scratchIndex);
+    void applyClipGain (ClipDescriptor& clip, juce::AudioBuffer<float>& buffer, int64_t position, int scratchIndex);
+    void addClipToOutput (const ClipTask& task, const juce::AudioBuffer<float>& buffer, const juce::AudioSourceChannelInfo& info);
+    void addToStem (int stemIndex, int offset, const juce::AudioBuffer<float>& buffer, int numSamples);
+
+    WorkerPool* workerPool = nullptr;
+
     juce::AudioBuffer<float> mixBuffer;
 
+    /** one channel of gain values for each parallel clip and one for the audio thread */
+    juce::AudioBuffer<float> gainBuffers;
+    /** the gains at the automation grid points, one channel like in gainBuffers */
+    juce::AudioBuffer<float> gridBuffers;
+    double                   sampleRate = 0.0;
+
+    std::vector<juce::AudioBuffer<float>>  noStems;
+    std::vector<juce::AudioBuffer<float>>* stemOutputs = &noStems;
+
+    std::vector<juce::AudioBuffer<float>> clipBuffers;
+    std::vector<ClipTask>                 tasks;
+    int                                   parallelThreshold = 3;
+    int                                   maximumParallelClips = 32;
+
+    int64_t blockPosition = 0;
+    double  blockTime = 0.0;
+    int     blockNumSamples = 0;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DefaultAudioMixer)
 };
 
@@ -24,6 +24,7 @@ namespace foleys
 namespace IDs
 {
     static juce::Identifier keyframe        { "Keyframe" };
+    static juce::Identifier keyframeData    { "KeyframeData" };
     static juce::Identifier time            { "Time" };
 }
 
@@ -62,21 +63,35 @@ void ParameterAutomation::addKeyframe (double pts, double newValue)
     if (pts < 0.0)
         return;
 
-    auto child = state.getChildWithProperty (IDs::time, pts);
-    if (child.isValid())
+    newValue = juce::jlimit (0.0, 1.0, newValue);
+
+    if (isEditedCompact() || int (keyframes.size()) + 1 >= compactStorageThreshold)
     {
-        child.setProperty (IDs::value, juce::jlimit (0.0, 1.0, newValue), nullptr);
+        auto keys = keyframes;
+        keys [pts] = newValue;
+        updateCompactKeyframes (std::move (keys));
     }
     else
     {
-        juce::ValueTree keyframe (IDs::keyframe);
-        keyframe.setProperty (IDs::time, pts, nullptr);
-        keyframe.setProperty (IDs::value, juce::jlimit (0.0, 1.0, newValue), nullptr);
-        state.addChild (keyframe, -1, undoManager);
-    }
+        {
+            juce::ScopedValueSetter<bool> manual (manualUpdate, true);
+
+            auto child = state.getChildWithProperty (IDs::time, pts);
+            if (child.isValid())
+            {
+                child.setProperty (IDs::value, newValue, nullptr);
+            }
+            else
+            {
+                juce::ValueTree keyframe (IDs::keyframe);
+                keyframe.setProperty (IDs::time, pts, nullptr);
+                keyframe.setProperty (IDs::value, newValue, nullptr);
+                state.addChild (keyframe, getSortedChildIndex (pts), undoManager);
+            }
+        }
 
-    sortKeyframesInValueTree();
-    loadFromValueTree();
+        loadFromValueTree();
+    }
 
     controllable.notifyParameterAutomationChange (this);
 }
@@ -86,13 +101,30 @@ void ParameterAutomation::setKeyframe (int index, double pts, double newValue)
     if (pts < 0.0)
         return;
 
-    auto key = state.getChild (index);
-    if (key.isValid())
+    if (isEditedCompact())
     {
-        key.setProperty (IDs::time, pts, undoManager);
-        key.setProperty (IDs::value, juce::jlimit (0.0, 1.0, newValue), undoManager);
-        sortKeyframesInValueTree();
-        loadFromValueTree();
+        if (juce::isPositiveAndBelow (index, keyframes.size()))
+        {
+            auto keys = keyframes;
+            keys.erase (std::next (keys.begin(), index));
+            keys [pts] = juce::jlimit (0.0, 1.0, newValue);
+            updateCompactKeyframes (std::move (keys));
+        }
+    }
+    else
+    {
+        auto key = state.getChild (index);
+        if (key.isValid())
+        {
+            {
+                juce::ScopedValueSetter<bool> manual (manualUpdate, true);
+                key.setProperty (IDs::time, pts, undoManager);
+                key.setProperty (IDs::value, juce::jlimit (0.0, 1.0, newValue), undoManager);
+                sortKeyframesInValueTree();
+            }
+
+            loadFromValueTree();
+        }
     }
 
     controllable.notifyParameterAutomationChange (this);
@@ -100,32 +132,62 @@ void ParameterAutomation::setKeyframe (int index, double pts, double newValue)
 
 void ParameterAutomation::deleteKeyframe (int index)
 {
-    state.removeChild (index, undoManager);
-    loadFromValueTree();
+    if (isEditedCompact())
+    {
+        if (juce::isPositiveAndBelow (index, keyframes.size()))
+        {
+            auto keys = keyframes;
+            keys.erase (std::next (keys.begin(), index));
+            updateCompactKeyframes (std::move (keys));
+        }
+    }
+    else
+    {
+        {
+            juce::ScopedValueSetter<bool> manual (manualUpdate, true);
+            state.removeChild (index, undoManager);
+        }
+
+        loadFromValueTree();
+    }
 
     controllable.notifyParameterAutomationChange (this);
 }
 
 double ParameterAutomation::getValueForTime (double pts) const
 {
-    if (keyframes.empty())
-        return getValue();
+    if (! automated.load())
+        return staticValue.load();
 
-    const auto& next = keyframes.upper_bound (pts);
-    if (next == keyframes.begin())
-        return next->second;
+    auto compiled = curve.read();
+    return compiled->getValueAt (pts);
+}
 
-    const auto& prev = std::next (next, -1);
-    if (next == keyframes.cend())
-        return prev->second;
+double ParameterAutomation::getValueForTime (double pts, AutomationCurve::Cursor& cursor) const
+{
+    if (! automated.load())
+        return staticValue.load();
+
+    auto compiled = curve.read();
+    return compiled->getValueAt (pts, cursor);
+}
 
-    auto dy = next->first - prev->first;
-    if (dy == 0.0)
-        return juce::jlimit (0.0, 1.0, 0.5 * (prev->second + next->second));
+void ParameterAutomation::getRealValuesForTime (int64_t start, int64_t interval, double timebase, double timeOffset,
+                                                float* realValues, int numValues, AutomationCurve::Cursor& cursor) const
+{
+    if (! automated.load())
+    {
+        juce::FloatVectorOperations::fill (realValues, float (convertToRealValue (staticValue.load())), numValues);
+        return;
+    }
 
-    auto dx = next->second - prev->second;
-    auto interpolated = prev->second + (pts - prev->first) * dx / dy;
-    return juce::jlimit (0.0, 1.0, interpolated);
+    {
+        auto compiled = curve.read();
+        compiled->getValuesAt (start, interval, timebase, timeOffset, realValues, numValues, cursor);
+    }
+
+    for (int i = 0; i < numValues; ++i)
+        realValues [i] = float (convertToRealValue (realValues [i]));
 }
 
 double ParameterAutomation::getValue() const
@@ -133,6 +195,17 @@ double ParameterAutomation::getValue() const
     return value.get();
 }
 
+bool ParameterAutomation::hasKeyframes() const
+{
+    return automated.load();
+}
+
+bool ParameterAutomation::isChangingBetween (double startTime, double endTime) const
+{
+    auto compiled = curve.read();
+    return compiled->isChangingBetween (startTime, endTime);
+}
+
 double ParameterAutomation::getPreviousKeyframeTime (double time) const
 {
     if (keyframes.empty())
@@ -175,6 +248,12 @@ void ParameterAutomation::startAutomationGesture()
 void ParameterAutomation::finishAutomationGesture()
 {
     gestureInProgress = false;
+
+    if (std::exchange (compactWritePending, false))
+    {
+        juce::ScopedValueSetter<bool> manual (manualUpdate, true);
+        writeKeyframesToValueTree (keyframes);
+    }
 }
 
 const std::map<double, double>& ParameterAutomation::getKeyframes() const
@@ -182,11 +261,133 @@ const std::map<double, double>& ParameterAutomation::getKeyframes() const
     return keyframes;
 }
 
-void ParameterAutomation::setKeyframes (std::map<double, double> keys)
+void ParameterAutomation::setKeyframes (std::map<double, double> keys, double tolerance)
 {
     if (undoManager)
         undoManager->beginNewTransaction();
 
+    if (tolerance > 0.0)
+        keys = simplifyKeyframes (keys, tolerance);
+
+    {
+        juce::ScopedValueSetter<bool> manual (manualUpdate, true);
+        writeKeyframesToValueTree (keys);
+    }
+
+    loadFromValueTree();
+}
+
+std::map<double, double> ParameterAutomation::simplifyKeyframes (const std::map<double, double>& keys, double tolerance)
+{
+    if (keys.size() < 3 || tolerance <= 0.0)
+        return keys;
+
+    // Ramer-Douglas-Peucker, iterative to cope with long curves
+    const std::vector<std::pair<double, double>> points (keys.begin(), keys.end());
+    std::vector<bool> keep (points.size(), false);
+    keep.front() = true;
+    keep.back()  = true;
+
+    std::vector<std::pair<size_t, size_t>> ranges { { size_t (0), points.size() - 1 } };
+    while (! ranges.empty())
+    {
+        const auto range = ranges.back();
+        ranges.pop_back();
+
+        const auto& first = points [range.first];
+        const auto& last  = points [range.second];
+        const auto  slope = (last.second - first.second) / (last.first - first.first);
+
+        // the curve is interpolated over time, so the error is the vertical distance
+        auto maxDistance = 0.0;
+        auto maxIndex    = range.first;
+        for (auto i = range.first + 1; i < range.second; ++i)
+        {
+            const auto distance = std::abs (points [i].second - (first.second + (points [i].first - first.first) * slope));
+            if (distance > maxDistance)
+            {
+                maxDistance = distance;
+                maxIndex    = i;
+            }
+        }
+
+        if (maxDistance > tolerance)
+        {
+            keep [maxIndex] = true;
+            ranges.push_back ({ range.first, maxIndex });
+            ranges.push_back ({ maxIndex, range.second });
+        }
+    }
+
+    std::map<double, double> simplified;
+    for (size_t i = 0; i < points.size(); ++i)
+        if (keep [i])
+            simplified.emplace_hint (simplified.end(), points [i]);
+
+    return simplified;
+}
+
+bool ParameterAutomation::isStoredCompact() const
+{
+    return state.hasProperty (IDs::keyframeData);
+}
+
+bool ParameterAutomation::isEditedCompact() const
+{
+    return compactWritePending || isStoredCompact();
+}
+
+void ParameterAutomation::updateCompactKeyframes (std::map<double, double> keys)
+{
+    // each write copies all keyframes into a new blob and the UndoManager, so a gesture writes once when it finishes
+    if (gestureInProgress)
+    {
+        compactWritePending = true;
+        publishKeyframes (std::move (keys));
+        return;
+    }
+
+    {
+        juce::ScopedValueSetter<bool> manual (manualUpdate, true);
+        writeKeyframesToValueTree (keys);
+    }
+
+    loadFromValueTree();
+}
+
+int ParameterAutomation::getSortedChildIndex (double pts) const
+{
+    int index = 0;
+    for (const auto& child : state)
+    {
+        if (double (child.getProperty (IDs::time)) > pts)
+            break;
+
+        ++index;
+    }
+
+    return index;
+}
+
+void ParameterAutomation::writeKeyframesToValueTree (const std::map<double, double>& keys)
+{
+    if (int (keys.size()) >= compactStorageThreshold)
+    {
+        // one property for all keyframes keeps loading and undo fast
+        juce::MemoryOutputStream stream;
+        for (const auto& k : keys)
+        {
+            stream.writeDouble (k.first);
+            stream.writeDouble (k.second);
+        }
+
+        state.removeAllChildren (undoManager);
+        state.setProperty (IDs::keyframeData, stream.getMemoryBlock(), undoManager);
+        return;
+    }
+
+    state.removeProperty (IDs::keyframeData, undoManager);
+
     int index = 0;
     for (auto& k : keys)
     {
@@ -208,15 +409,23 @@ void ParameterAutomation::setKeyframes (std::map<double, double> keys)
 
     while (state.getNumChildren() > index)
         state.removeChild (index, undoManager);
-
-    loadFromValueTree();
 }
 
 void ParameterAutomation::loadFromValueTree()
 {
-    juce::ScopedValueSetter<bool>(manualUpdate, true);
-
     std::map<double, double> newKeyframes;
+
+    if (auto* block = state.getProperty (IDs::keyframeData).getBinaryData())
+    {
+        juce::MemoryInputStream stream (*block, false);
+        while (stream.getNumBytesRemaining() >= juce::int64 (2 * sizeof (double)))
+        {
+            auto t = stream.readDouble();
+            auto v = stream.readDouble();
+            newKeyframes.emplace_hint (newKeyframes.end(), t, v);
+        }
+    }
+
     for (const auto& child : state)
     {
         if (!child.hasProperty (IDs::time) || !child.hasProperty (IDs::value))
@@ -227,7 +436,20 @@ void ParameterAutomation::loadFromValueTree()
         newKeyframes [t] = v;
     }
 
-    keyframes = newKeyframes;
+    // an external change like undo replaces the keyframes of an unfinished gesture
+    compactWritePending = false;
+    publishKeyframes (std::move (newKeyframes));
+}
+
+void ParameterAutomation::publishKeyframes (std::map<double, double> newKeyframes)
+{
+    // read the value from the state, the CachedValue might not be notified yet
+    const auto newValue = double (state.getProperty (IDs::value, value.getDefault()));
+    curve.publish (std::make_unique<AutomationCurve> (newKeyframes, newValue));
+    staticValue = newValue;
+    automated = ! newKeyframes.empty();
+
+    keyframes = std::move (newKeyframes);
     controllable.notifyParameterAutomationChange (this);
 }
 
@@ -258,17 +480,17 @@ void ParameterAutomation::sortKeyframesInValueTree()
 
 void ParameterAutomation::valueTreePropertyChanged (juce::ValueTree&, const juce::Identifier&)
 {
-    loadFromValueTree();
+    reloadOrDefer();
 }
 
 void ParameterAutomation::valueTreeChildAdded (juce::ValueTree&, juce::ValueTree&)
 {
-    loadFromValueTree();
+    reloadOrDefer();
 }
 
 void ParameterAutomation::valueTreeChildRemoved (juce::ValueTree&, juce::ValueTree&, int)
 {
-    loadFromValueTree();
+    reloadOrDefer();
 }
 
 ControllableBase& ParameterAutomation::getControllable()
@@ -276,6 +498,23 @@ ControllableBase& ParameterAutomation::getControllable()
     return controllable;
 }
 
+void ParameterAutomation::reloadOrDefer()
+{
+    if (manualUpdate)
+        return;
+
+    if (controllable.isDeferringUpdates())
+        reloadPending = true;
+    else
+        loadFromValueTree();
+}
+
+void ParameterAutomation::applyPendingReload()
+{
+    if (std::exchange (reloadPending, false))
+        loadFromValueTree();
+}
+
 //==============================================================================
 
 AudioParameterAutomation::AudioParameterAutomation (ProcessorController& controllerToUse,
@@ -332,16 +571,27 @@ double AudioParameterAutomation::getValueForText (const juce::String& text) cons
 
 void AudioParameterAutomation::updateProcessor (double pts)
 {
-    if (!gestureInProgress)
-        parameter.setValueNotifyingHost (float (getValueForTime (pts)));
+    if (gestureInProgress)
+        return;
+
+    const auto newValue = float (getValueForTime (pts, playbackCursor));
+
+    // without keyframes avoid notifying the host each block
+    if (hasKeyframes() || parameter.getValue() != newValue)
+        parameter.setValueNotifyingHost (newValue);
 }
 
 double AudioParameterAutomation::getRealValueForTime (double pts) const
+{
+    return convertToRealValue (getValueForTime (pts));
+}
+
+double AudioParameterAutomation::convertToRealValue (double normalisedValue) const
 {
     if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(&parameter))
-        return ranged->getNormalisableRange().convertFrom0to1 (float (getValueForTime (pts)));
+        return ranged->getNormalisableRange().convertFrom0to1 (float (normalisedValue));
 
-    return getValueForTime (pts);
+    return normalisedValue;
 }
 
 void AudioParameterAutomation::setRealValue (double value)
@@ -446,13 +696,24 @@ double VideoParameterAutomation::getValueForText (const juce::String& text) cons
 
 void VideoParameterAutomation::updateProcessor (double pts)
 {
-    if (!gestureInProgress)
-        parameter.setNormalisedValue (getValueForTime (pts));
+    if (gestureInProgress)
+        return;
+
+    const auto newValue = getValueForTime (pts, playbackCursor);
+
+    // without keyframes avoid notifying the listeners each frame
+    if (hasKeyframes() || parameter.getNormalisedValue() != newValue)
+        parameter.setNormalisedValue (newValue);
 }
 
 double VideoParameterAutomation::getRealValueForTime (double pts) const
 {
-    return parameter.unNormaliseValue (getValueForTime (pts));
+    return convertToRealValue (getValueForTime (pts));
+}
+
+double VideoParameterAutomation::convertToRealValue (double normalisedValue) const
+{
+    return parameter.unNormaliseValue (normalisedValue);
 }
 
 void VideoParameterAutomation::setRealValue (double value)
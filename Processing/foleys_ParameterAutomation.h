@@ -95,13 +95,48 @@ public:
      */
     double         getValueForTime (double pts) const;
 
+    /**
+     Returns the normalised value at a certain time. The cursor speeds up sequential reading,
+     each reading thread needs to use it's own cursor.
+     */
+    double         getValueForTime (double pts, AutomationCurve::Cursor& cursor) const;
+
     /**
      Returns the unnormalised value at a certain time.
      */
     virtual double getRealValueForTime (double pts) const = 0;
 
+    /**
+     Fills realValues with the unnormalised values at the times (start + n * interval) / timebase + timeOffset,
+     e.g. to read a whole audio block at once. This is safe to call from the realtime threads.
+     */
+    void getRealValuesForTime (int64_t start, int64_t interval, double timebase, double timeOffset,
+                               float* realValues, int numValues, AutomationCurve::Cursor& cursor) const;
+
+    /**
+     Converts a normalised value into the unnormalised range of the parameter.
+     */
+    virtual double convertToRealValue (double normalisedValue) const { return normalisedValue; }
+
+    /**
+     The cursor used by updateProcessor. Only use this from the thread calling updateProcessor.
+     */
+    AutomationCurve::Cursor& getPlaybackCursor() { return playbackCursor; }
+
     double getValue() const;
 
+    /**
+     Returns true, if the automation has keyframes. Otherwise the value is constant
+     and the realtime callbacks can skip evaluating the curve.
+     */
+    bool hasKeyframes() const;
+
+    /**
+     Returns true, if the value is not constant between the two timepoints. This is used
+     to split audio blocks only where the automation actually changes.
+     */
+    bool isChangingBetween (double startTime, double endTime) const;
+
     double getPreviousKeyframeTime (double time) const;
     double getNextKeyframeTime (double time) const;
 
@@ -113,7 +148,7 @@ public:
 
     /**
      Call this to finish user interaction to give back controll to the
-     playing automation.
+     playing automation. Edits of compact stored keyframes are written to the state now.
      */
     void finishAutomationGesture();
 
@@ -123,9 +158,25 @@ public:
     const std::map<double, double>& getKeyframes() const;
 
     /**
-     Replace all keyframes
+     Replace all keyframes in one undoable transaction, e.g. to import automation from
+     motion tracking or audio analysis.
+     @param keys      the new keyframes (time -> normalised value)
+     @param tolerance if greater than 0, keyframes are removed, as long as the curve
+                      doesn't deviate more than the tolerance (normalised)
+     */
+    void  setKeyframes (std::map<double, double> keys, double tolerance = 0.0);
+
+    /**
+     Thins out keyframes using the Ramer-Douglas-Peucker algorithm. The interpolated curve
+     of the result stays within the tolerance of the original keyframes.
      */
-    void  setKeyframes (std::map<double, double> keys);
+    static std::map<double, double> simplifyKeyframes (const std::map<double, double>& keys, double tolerance);
+
+    /**
+     Automations with at least this many keyframes are stored as one binary property
+     instead of a child for each keyframe.
+     */
+    static constexpr int compactStorageThreshold = 256;
 
     virtual juce::String getText (float normalisedValue, int numDigits = 2) const = 0;
     virtual double getValueForText (const juce::String& text) const = 0;
@@ -137,15 +188,27 @@ public:
 
     ControllableBase& getControllable();
 
+    /** @internal Reloads the keyframes, if the state changed while the updates were deferred */
+    void applyPendingReload();
+
 protected:
 
     ControllableBase& controllable;
     bool gestureInProgress = false;
 
+    AutomationCurve::Cursor playbackCursor;
+
 private:
 
     void loadFromValueTree();
+    void publishKeyframes (std::map<double, double> newKeyframes);
+    void reloadOrDefer();
     void sortKeyframesInValueTree();
+    void writeKeyframesToValueTree (const std::map<double, double>& keys);
+    bool isStoredCompact() const;
+    bool isEditedCompact() const;
+    void updateCompactKeyframes (std::map<double, double> keys);
+    int  getSortedChildIndex (double pts) const;
 
     /** @internal */
     void valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
@@ -172,6 +235,12 @@ private:
     juce::CachedValue<double> value;
     std::map<double, double> keyframes;
     bool manualUpdate = false;
+    bool reloadPending = false;
+    bool compactWritePending = false;
+
+    AtomicSnapshot<AutomationCurve> curve;
+    std::atomic<bool>               automated { false };
+    std::atomic<double>             staticValue { 0.0 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterAutomation)
 };
@@ -200,6 +269,7 @@ public:
 
     void updateProcessor (double pts) override;
     double getRealValueForTime (double pts) const override;
+    double convertToRealValue (double normalisedValue) const override;
 
     void setRealValue (double value) override;
     void setRealValue (double pts, double value) override;
@@ -246,6 +316,7 @@ public:
 
     void updateProcessor (double pts) override;
     double getRealValueForTime (double pts) const override;
+    double convertToRealValue (double normalisedValue) const override;
 
     void setRealValue (double value) override;
     void setRealValue (double pts, double value) override;
@@ -164,48 +164,91 @@ private:
 
 //==============================================================================
 
-ProcessorController::ProcessorController (ClipDescriptor& ownerToUse,
-                                          std::unique_ptr<juce::AudioProcessor> processorToUse,
+ProcessorController::ProcessorController (TimeCodeAware& timeReference,
+                                          ComposedClip& owningClipToUse,
                                           juce::UndoManager* undo)
-  : ControllableBase (ownerToUse),
-    owner (ownerToUse),
+  : ControllableBase (timeReference),
+    owningClip (owningClipToUse),
     undoManager (undo)
 {
-    adapter = std::make_unique<AudioProcessorAdapter> (std::move (processorToUse));
-    state = juce::ValueTree { IDs::audioProcessor };
-    state.setProperty (IDs::name, adapter->getName(), undoManager);
-    state.setProperty (IDs::identifier, adapter->getIdentifierString(), undoManager);
+}
 
-    adapter->createAutomatedParameters (*this, parameters, state, undoManager);
+ProcessorController::ProcessorController (ClipDescriptor& ownerToUse,
+                                          std::unique_ptr<juce::AudioProcessor> processorToUse,
+                                          juce::UndoManager* undo)
+  : ProcessorController (ownerToUse, ownerToUse.getOwningClip(), undo)
+{
+    descriptor = &ownerToUse;
+    setAudioProcessor (std::move (processorToUse));
 }
 
 ProcessorController::ProcessorController (ClipDescriptor& ownerToUse,
                                           std::unique_ptr<VideoProcessor> processorToUse,
                                           juce::UndoManager* undo)
-  : ControllableBase (ownerToUse),
-    owner (ownerToUse),
-    undoManager (undo)
+  : ProcessorController (ownerToUse, ownerToUse.getOwningClip(), undo)
 {
+    descriptor = &ownerToUse;
+
     adapter = std::make_unique<VideoProcessorAdapter> (std::move (processorToUse));
     state = juce::ValueTree { IDs::videoProcessor };
     state.setProperty (IDs::name, adapter->getName(), undoManager);
     state.setProperty (IDs::identifier, adapter->getIdentifierString(), undoManager);
 
     adapter->createAutomatedParameters (*this, parameters, state, undoManager);
+    updateParameterHandles();
+    state.addListener (this);
 }
 
 ProcessorController::ProcessorController (ClipDescriptor& ownerToUse,
                                           const juce::ValueTree& stateToUse,
                                           juce::UndoManager* undo, int)
-  : ControllableBase (ownerToUse),
-    owner (ownerToUse),
-    undoManager (undo)
+  : ProcessorController (ownerToUse, ownerToUse.getOwningClip(), undo)
+{
+    descriptor = &ownerToUse;
+    loadFromState (stateToUse);
+}
+
+ProcessorController::ProcessorController (AudioBus& ownerToUse,
+                                          std::unique_ptr<juce::AudioProcessor> processorToUse,
+                                          juce::UndoManager* undo)
+  : ProcessorController (ownerToUse, ownerToUse.getOwningClip(), undo)
+{
+    bus = &ownerToUse;
+    setAudioProcessor (std::move (processorToUse));
+}
+
+ProcessorController::ProcessorController (AudioBus& ownerToUse,
+                                          const juce::ValueTree& stateToUse,
+                                          juce::UndoManager* undo, int)
+  : ProcessorController (ownerToUse, ownerToUse.getOwningClip(), undo)
+{
+    bus = &ownerToUse;
+
+    // a bus can only host AudioProcessors
+    jassert (stateToUse.getType() == IDs::audioProcessor);
+    loadFromState (stateToUse);
+}
+
+void ProcessorController::setAudioProcessor (std::unique_ptr<juce::AudioProcessor> processorToUse)
+{
+    adapter = std::make_unique<AudioProcessorAdapter> (std::move (processorToUse));
+    state = juce::ValueTree { IDs::audioProcessor };
+    state.setProperty (IDs::name, adapter->getName(), undoManager);
+    state.setProperty (IDs::identifier, adapter->getIdentifierString(), undoManager);
+
+    adapter->createAutomatedParameters (*this, parameters, state, undoManager);
+    updateParameterHandles();
+    state.addListener (this);
+}
+
+void ProcessorController::loadFromState (const juce::ValueTree& stateToUse)
 {
     state = stateToUse;
+    active = bool (state.getProperty (IDs::active, true));
+    state.addListener (this);
 
     const auto identifier = state.getProperty (IDs::identifier);
-    auto& composedClip = owner.getOwningClip();
-    auto* engine = composedClip.getVideoEngine();
+    auto* engine = owningClip.getVideoEngine();
 
     if (engine == nullptr)
     {
@@ -216,7 +259,7 @@ ProcessorController::ProcessorController (ClipDescriptor& ownerToUse,
     juce::String error;
     if (state.getType() == IDs::audioProcessor)
     {
-        auto processor = engine->createAudioPluginInstance (identifier, composedClip.getSampleRate(), composedClip.getDefaultBufferSize(), error);
+        auto processor = engine->createAudioPluginInstance (identifier, owningClip.getSampleRate(), owningClip.getDefaultBufferSize(), error);
         if (processor.get() != nullptr)
         {
             if (state.hasProperty (IDs::state))
@@ -231,6 +274,7 @@ ProcessorController::ProcessorController (ClipDescriptor& ownerToUse,
             }
             adapter = std::make_unique<AudioProcessorAdapter> (std::move (processor));
             adapter->createAutomatedParameters (*this, parameters, state, undoManager);
+            updateParameterHandles();
         }
     }
     else if (state.getType() == IDs::videoProcessor)
@@ -250,6 +294,7 @@ ProcessorController::ProcessorController (ClipDescriptor& ownerToUse,
             }
             adapter = std::make_unique<VideoProcessorAdapter> (std::move (processor));
             adapter->createAutomatedParameters (*this, parameters, state, undoManager);
+            updateParameterHandles();
         }
     }
     else
@@ -281,21 +326,94 @@ juce::String ProcessorController::getName() const
 
 double ProcessorController::getCurrentPTS() const
 {
-    return owner.getCurrentTimeInSeconds();
+    return getTimeReference().getCurrentTimeInSeconds();
 }
 
 double ProcessorController::getValueAtTime (juce::Identifier paramID, double pts, double defaultValue)
 {
-    if (auto* parameter = parameters [paramID].get())
-        return parameter->getRealValueForTime (pts);
+    auto parameter = parameters.find (paramID);
+    if (parameter != parameters.end() && parameter->second != nullptr)
+        return parameter->second->getRealValueForTime (pts);
 
     return defaultValue;
 }
 
+bool ProcessorController::isDeferringUpdates() const
+{
+    return owningClip.isInBatchEdit();
+}
+
 void ProcessorController::updateAutomation (double pts)
 {
-    for (auto& parameter : parameters)
-        parameter.second->updateProcessor (pts);
+    for (auto* parameter : getParameterList())
+        parameter->updateProcessor (pts);
+}
+
+bool ProcessorController::isAutomationChanging (double startTime, double endTime) const
+{
+    for (const auto* parameter : getParameterList())
+        if (parameter->isChangingBetween (startTime, endTime))
+            return true;
+
+    return false;
+}
+
+void ProcessorController::processAudio (juce::AudioBuffer<float>& buffer,
+                                        juce::MidiBuffer& midi,
+                                        int64_t position,
+                                        double sampleRate,
+                                        int64_t playheadOffset,
+                                        double timeOffset)
+{
+    auto* audioProcessor = getAudioProcessor();
+    if (audioProcessor == nullptr || audioProcessor->isSuspended() || sampleRate <= 0)
+        return;
+
+    const auto numSamples = buffer.getNumSamples();
+    auto getTime = [sampleRate](int64_t sample) { return sample / sampleRate; };
+
+    auto process = [&](int startSample, int length)
+    {
+        juce::AudioBuffer<float> subBlock (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), startSample, length);
+        setPosition (position + startSample - playheadOffset, getTime (position + startSample));
+
+        if (isActive())
+            audioProcessor->processBlock (subBlock, midi);
+        else
+            audioProcessor->processBlockBypassed (subBlock, midi);
+    };
+
+    // the sub-blocks are aligned to an absolute grid, so the split points don't depend on the block size
+    const auto interval = int64_t (minimumSubBlockSize.load());
+    auto cell = position >= 0 ? position - position % interval
+                              : position - ((position % interval) + interval) % interval;
+
+    int startSample = 0;
+    while (startSample < numSamples)
+    {
+        // join the following grid cells, as long as the automation keeps the value of this cell
+        auto endSample = int (std::min (int64_t (numSamples), cell + interval - position));
+        while (endSample < numSamples && ! isAutomationChanging (getTime (cell) + timeOffset,
+                                                                 getTime (position + std::min (endSample + interval, int64_t (numSamples))) + timeOffset))
+            endSample = int (std::min (int64_t (numSamples), endSample + interval));
+
+        updateAutomation (getTime (cell) + timeOffset);
+        process (startSample, endSample - startSample);
+
+        startSample = endSample;
+        cell = position + endSample;
+    }
+}
+
+void ProcessorController::setMinimumSubBlockSize (int numSamples)
+{
+    const auto numCells = std::max (1, (numSamples + automationGridSize - 1) / automationGridSize);
+    minimumSubBlockSize = numCells * automationGridSize;
+}
+
+int ProcessorController::getMinimumSubBlockSize() const
+{
+    return minimumSubBlockSize.load();
 }
 
 juce::ValueTree& ProcessorController::getProcessorState()
@@ -307,14 +425,21 @@ void ProcessorController::setActive (bool shouldBeActive)
 {
     if (bool (state.getProperty (IDs::active, true)) != shouldBeActive)
     {
-        state.setProperty (IDs::active, shouldBeActive, owner.getOwningClip().getUndoManager());
-        owner.getOwningClip().invalidateVideo();
+        state.setProperty (IDs::active, shouldBeActive, owningClip.getUndoManager());
+        owningClip.invalidateVideo();
     }
 }
 
 bool ProcessorController::isActive() const
 {
-    return state.getProperty (IDs::active, true);
+    return active.load();
+}
+
+void ProcessorController::valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
+                                                    const juce::Identifier& property)
+{
+    if (treeWhosePropertyHasChanged == state && property == IDs::active)
+        active = bool (state.getProperty (IDs::active, true));
 }
 
 void ProcessorController::setPosition (juce::int64 timeInSamples, double timeInSeconds)
@@ -332,9 +457,19 @@ int ProcessorController::getNumParameters() const
     return int (parameters.size());
 }
 
-ClipDescriptor& ProcessorController::getOwningClipDescriptor()
+ClipDescriptor* ProcessorController::getOwningClipDescriptor()
+{
+    return descriptor;
+}
+
+AudioBus* ProcessorController::getOwningBus()
+{
+    return bus;
+}
+
+ComposedClip& ProcessorController::getOwningClip()
 {
-    return owner;
+    return owningClip;
 }
 
 juce::AudioProcessor* ProcessorController::getAudioProcessor()
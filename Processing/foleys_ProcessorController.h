@@ -23,13 +23,15 @@
 namespace foleys
 {
 
+class AudioBus;
 
 /**
  The ProcessorController acts as container foe one AudioProcessor or VideoProcessor
- inside the ClipDescriptor. It also holds the automation data to update the
- ProcessorParameters according to the currently rendered position.
+ inside the ClipDescriptor or an AudioBus. It also holds the automation data to update
+ the ProcessorParameters according to the currently rendered position.
  */
-class ProcessorController  : public ControllableBase
+class ProcessorController  : public ControllableBase,
+                             private juce::ValueTree::Listener
 {
 public:
     /**
@@ -52,6 +54,18 @@ public:
      */
     ProcessorController (ClipDescriptor& owner, const juce::ValueTree& state, juce::UndoManager* undo, int index);
 
+    /**
+     This ProcessorController constructor creates an instance for an AudioBus using a given
+     AudioProcessor. The automation is relative to the ComposedClip owning the bus.
+     */
+    ProcessorController (AudioBus& owner, std::unique_ptr<juce::AudioProcessor> processor, juce::UndoManager* undo);
+
+    /**
+     This ProcessorController constructor creates an AudioProcessor for an AudioBus
+     from a saved state in a ValueTree.
+     */
+    ProcessorController (AudioBus& owner, const juce::ValueTree& state, juce::UndoManager* undo, int index);
+
     ~ProcessorController() override;
 
     /** Returns the name of the controlled processor */
@@ -62,12 +76,50 @@ public:
 
     double getValueAtTime (juce::Identifier paramID, double pts, double defaultValue) override;
 
+    /** Updates are deferred while the owning ComposedClip is in a batch edit */
+    bool isDeferringUpdates() const override;
+
     /**
      This sets all parameters in the contained processor according to the current
      time point in seconds.
      */
     void updateAutomation (double pts);
 
+    /** Returns true, if any automated parameter changes between the two timepoints */
+    bool isAutomationChanging (double startTime, double endTime) const;
+
+    /**
+     Set the minimum length of the sub-blocks processAudio() splits a block into, while the
+     automation changes. It is rounded up to a multiple of ControllableBase::automationGridSize.
+     Shorter sub-blocks follow ramps more closely, but cost more processBlock() calls.
+     */
+    void setMinimumSubBlockSize (int numSamples);
+
+    /** Returns the minimum sub-block length in samples */
+    int getMinimumSubBlockSize() const;
+
+    /**
+     Process the buffer with the AudioProcessor using sample accurate automation. If the
+     automation changes inside the block, the block is split on an absolute grid of
+     getMinimumSubBlockSize() samples and the automation is evaluated at the start of each
+     sub-block. Neighbouring sub-blocks, in which the automation doesn't change, are processed
+     in one call, so the splits only happen where the values change. The split points don't
+     depend on the block size, and neither does the result.
+
+     @param buffer         the audio to process in place
+     @param midi           a MidiBuffer handed to the processor
+     @param position       the position of the first sample in the timeline of the ComposedClip
+     @param sampleRate     the sample rate of the timeline
+     @param playheadOffset is subtracted from the position for the playhead, e.g. the start of the clip
+     @param timeOffset     is added to the timeline time to get the automation time
+     */
+    void processAudio (juce::AudioBuffer<float>& buffer,
+                       juce::MidiBuffer& midi,
+                       int64_t position,
+                       double sampleRate,
+                       int64_t playheadOffset,
+                       double timeOffset);
+
     /** Read all plugins getStateInformation() and save it into the statusTree as BLOB */
     void readPluginStatesIntoValueTree();
 
@@ -75,7 +127,14 @@ public:
         It is your responsibility to avoid property or child collissions. */
     juce::ValueTree& getProcessorState();
 
-    ClipDescriptor& getOwningClipDescriptor();
+    /** Returns the ClipDescriptor this processor lives in, or nullptr if it is part of an AudioBus */
+    ClipDescriptor* getOwningClipDescriptor();
+
+    /** Returns the AudioBus this processor lives in, or nullptr if it is part of a ClipDescriptor */
+    AudioBus* getOwningBus();
+
+    /** Returns the ComposedClip, the clip or the bus belongs to */
+    ComposedClip& getOwningClip();
 
     struct ProcessorAdapter
     {
@@ -118,9 +177,29 @@ public:
 
 private:
 
-    ClipDescriptor& owner;
+    ProcessorController (TimeCodeAware& timeReference, ComposedClip& owningClip, juce::UndoManager* undo);
+
+    void setAudioProcessor (std::unique_ptr<juce::AudioProcessor> processor);
+    void loadFromState (const juce::ValueTree& state);
+
+    void valueTreePropertyChanged (juce::ValueTree& treeWhosePropertyHasChanged,
+                                   const juce::Identifier& property) override;
+
+    void valueTreeChildAdded (juce::ValueTree&, juce::ValueTree&) override {}
+    void valueTreeChildRemoved (juce::ValueTree&, juce::ValueTree&, int) override {}
+    void valueTreeChildOrderChanged (juce::ValueTree&, int, int) override {}
+    void valueTreeParentChanged (juce::ValueTree&) override {}
+
+    ComposedClip&   owningClip;
+    ClipDescriptor* descriptor = nullptr;
+    AudioBus*       bus = nullptr;
     juce::ValueTree state;
 
+    /** cached from the state for the audio and render callbacks */
+    std::atomic<bool> active { true };
+
+    std::atomic<int>  minimumSubBlockSize { 4 * automationGridSize };
+
     std::unique_ptr<ProcessorAdapter> adapter;
     AutomationMap                     parameters;
     juce::UndoManager*                undoManager=nullptr;
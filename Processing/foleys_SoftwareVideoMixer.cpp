@@ -21,6 +21,11 @@
 namespace foleys
 {
 
+SoftwareVideoMixer::SoftwareVideoMixer (WorkerPool* workerPoolToUse)
+  : workerPool (workerPoolToUse)
+{
+}
+
 void SoftwareVideoMixer::compose (juce::Image&        target,
                                   VideoStreamSettings settings,
                                   int64_t             count,
@@ -29,12 +34,13 @@ void SoftwareVideoMixer::compose (juce::Image&        target,
 {
     juce::ignoreUnused (count);
 
-    juce::Graphics g (target);
-    g.fillAll (juce::Colours::black);
+    target.clear (target.getBounds(), juce::Colours::black);
 
     const auto renderStart = juce::Time::getMillisecondCounter();
     const auto timeout = 1000;
 
+    layers.clear();
+
     for (const auto& clip : clips)
     {
         if (! juce::isPositiveAndBelow (timeInSeconds - clip->getStart(), clip->getLength()))
@@ -47,16 +53,18 @@ void SoftwareVideoMixer::compose (juce::Image&        target,
         if (clip->getVideoVisible() == false)
             continue;
 
-        const auto alpha    = float (clip->getVideoParameterController().getValueAtTime (IDs::alpha,  clipTime, 1.0));
-        const auto zoom     = clip->getVideoParameterController().getValueAtTime (IDs::zoom,   clipTime, 1.0);
-        const auto transX   = clip->getVideoParameterController().getValueAtTime (IDs::translateX, clipTime, 0.0);
-        const auto transY   = clip->getVideoParameterController().getValueAtTime (IDs::translateY, clipTime, 0.0);
-        const auto rotation = clip->getVideoParameterController().getValueAtTime (IDs::rotation, clipTime, 0.0);
+        const auto transform = clip->getVideoTransformAt (clipTime);
+        const auto alpha     = transform.alpha;
+        const auto zoom      = transform.zoom;
+        const auto transX    = transform.translateX;
+        const auto transY    = transform.translateY;
+        const auto rotation  = transform.rotation;
 
         if (clip->clip->waitForFrameReady (clipTime, std::min (timeout, int (juce::Time::getMillisecondCounter() + timeout - renderStart))) == false)
             continue;
 
-        auto frame = clip->clip->getFrame (clipTime).image;
+        auto frame = clip->getProcessedFrame (clipTime, settings);
+        const auto processed = clip->hasActiveVideoProcessors();
 
         auto factor = std::min (double (target.getWidth()) / frame.getWidth(),
                                       double (target.getHeight()) / frame.getHeight());
@@ -73,30 +81,25 @@ void SoftwareVideoMixer::compose (juce::Image&        target,
         if (frame.isNull() || w < 1 || h < 1)
             continue;
 
-        for (const auto& controller : clip->getVideoProcessors())
-        {
-            if (controller->isActive() == false)
-                continue;
-
-            controller->updateAutomation ((timeInSeconds - clip->getStart()) + clip->getOffset());
-            if (auto* videoProcessor = controller->getVideoProcessor())
-                videoProcessor->processFrame (frame, count, settings, clip->getLength());
-        }
-
-        juce::Graphics::ScopedSaveState save (g);
         auto posX = (settings.frameSize.width - w) * 0.5 + transX * w;
         auto posY = (settings.frameSize.height - h)  * 0.5 - transY * h;
-        g.setOpacity (alpha);
-        if (rotation != 0)
-            g.addTransform (juce::AffineTransform::rotation (float (rotation * juce::MathConstants<double>::pi / 180.0),
-                                                             float (posX + w * 0.5),
-                                                             float (posY + h * 0.5)));
 
         auto area = juce::Rectangle<double>(posX, posY, w, h).toNearestInt();
-        g.drawImageWithin (frame,
-                           area.getX(), area.getY(), area.getWidth(), area.getHeight(),
-                           juce::RectanglePlacement (juce::RectanglePlacement::centred));
+        auto transform = juce::RectanglePlacement (juce::RectanglePlacement::centred)
+                             .getTransformToFit (frame.getBounds().toFloat(), area.toFloat());
+
+        if (rotation != 0)
+            transform = transform.rotated (float (rotation * juce::MathConstants<double>::pi / 180.0),
+                                           float (posX + w * 0.5),
+                                           float (posY + h * 0.5));
+
+        // processors might add transparency, so only unprocessed frames hide the clips below
+        layers.push_back ({ frame, transform, alpha, Compositor::Sampling::bilinear, clip->clip->isOpaque() && ! processed });
     }
+
+    // waiting for the frames is done, now all clips are composited in one parallel pass
+    Compositor::drawLayers (target, layers, workerPool);
+    layers.clear();
 }
 
 } // foleys
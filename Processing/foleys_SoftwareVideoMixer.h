@@ -30,7 +30,10 @@ namespace foleys
 class SoftwareVideoMixer : public VideoMixer
 {
 public:
-    SoftwareVideoMixer() = default;
+    /**
+     Creates a mixer. If a WorkerPool is supplied, the frame is composited in bands of rows in parallel.
+     */
+    SoftwareVideoMixer (WorkerPool* workerPool = nullptr);
 
     /**
      The ComposedClip will call this to let you compose the various clips.
@@ -39,7 +42,8 @@ public:
      @param count is the frame counter in settings.timebase
      @param timeInSeconds is the current time in seconds, since the originating stream
             has not necessarily the same timebase
-     @param clips is a vector of ClipDescriptors. Each ClipDescriptor has it's own list of processors.
+     @param clips is a vector of ClipDescriptors active at timeInSeconds, see ClipTimeline::getClipsAt().
+            Each ClipDescriptor has it's own list of processors.
      */
     void compose (juce::Image& target,
                   VideoStreamSettings settings,
@@ -48,6 +52,9 @@ public:
                   const   std::vector<std::shared_ptr<ClipDescriptor>>& clips) override;
 
 private:
+    WorkerPool*           workerPool = nullptr;
+    Compositor::LayerList layers;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SoftwareVideoMixer)
 };
 
@@ -411,17 +411,49 @@ private:
             if (response >= 0)
             {
                 AVRational timeBase = av_make_q (1, AV_TIME_BASE);
+                AVRational frameRate = av_make_q (10, 1);
                 if (juce::isPositiveAndBelow (videoStreamIdx, static_cast<int> (formatContext->nb_streams)))
                 {
                     timeBase = formatContext->streams [videoStreamIdx]->time_base;
+                    if (formatContext->streams [videoStreamIdx]->avg_frame_rate.num > 0)
+                        frameRate = formatContext->streams [videoStreamIdx]->avg_frame_rate;
                 }
 
                 auto& target = videoFifo.getWritingFrame();
-                if (target.image.getWidth() != frame->width || target.image.getHeight() != frame->height)
-                    target.image = juce::Image (juce::Image::ARGB, frame->width, frame->height, false);
-
-                scaler.convertFrameToImage (target.image, frame);
                 target.timecode = frame->best_effort_timestamp;
+
+                // a covered frame is only decoded, converting it would be wasted
+                if (frame->best_effort_timestamp * av_q2d (timeBase) + av_q2d (av_inv_q (frameRate)) < reader.videoDiscardedUntil)
+                {
+                    target.image = juce::Image();
+                    videoFifo.finishWriting();
+                    continue;
+                }
+
+                // the decoder needs every packet for its state, but other readers of the same
+                // media might have converted this frame already. A single reader reuses the fifo's images
+                auto* cache = reader.frameCache != nullptr && reader.frameCache->isShared (reader.frameCacheMedia) ? reader.frameCache : nullptr;
+
+                FrameCache::Key key { reader.frameCacheMedia, videoStreamIdx, frame->best_effort_timestamp, frame->width, frame->height };
+                auto cached = cache != nullptr ? cache->getFrame (key) : juce::Image();
+
+                if (cached.isValid())
+                {
+                    target.image = cached;
+                }
+                else
+                {
+                    // an image shared with the cache must not be overwritten
+                    if (target.image.getWidth() != frame->width || target.image.getHeight() != frame->height
+                        || target.image.getReferenceCount() > 1)
+                        target.image = juce::Image (juce::Image::ARGB, frame->width, frame->height, false);
+
+                    scaler.convertFrameToImage (target.image, frame);
+
+                    if (cache != nullptr)
+                        cache->addFrame (key, target.image);
+                }
+
                 videoFifo.finishWriting();
 
                 FOLEYS_LOG ("Stream " << juce::String (packet.stream_index) <<
@@ -24,6 +24,11 @@ namespace foleys
 AVFormatManager::AVFormatManager()
 {
     audioFormatManager.registerBasicFormats();
+
+    registerFactory (MulticamClip::scheme, [](VideoEngine& engine, juce::URL url, StreamTypes type) -> std::shared_ptr<AVClip>
+    {
+        return MulticamClip::createFromUrl (engine, url, type);
+    });
 }
 
 std::shared_ptr<AVClip> AVFormatManager::createClipFromFile (VideoEngine& engine, juce::URL url, StreamTypes type)
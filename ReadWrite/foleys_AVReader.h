@@ -34,7 +34,10 @@ class AVReader
 public:
 
     AVReader() = default;
-    virtual ~AVReader() = default;
+    virtual ~AVReader()
+    {
+        setFrameCache (nullptr);
+    }
 
     virtual juce::File getMediaFile() const = 0;
 
@@ -67,6 +70,25 @@ public:
 
     virtual void setOutputSampleRate (double sampleRate) = 0;
 
+    /** Set the FrameCache of the engine to share decoded frames with other readers of
+        the same media. The cache must outlive the reader. Call this after opening the media. */
+    void setFrameCache (FrameCache* cache)
+    {
+        if (frameCache != nullptr)
+            frameCache->removeReader (frameCacheMedia);
+
+        frameCache = cache;
+        frameCacheMedia = cache != nullptr ? getMediaFile().getFullPathName() : juce::String();
+
+        if (frameCache != nullptr)
+            frameCache->addReader (frameCacheMedia);
+    }
+
+    /** Tells the reader, that video frames before that time in seconds won't be shown, e.g.
+        because they are covered in the composition. The reader still decodes them to keep the
+        decoder running, but may skip converting them and deliver frames without image. */
+    void setVideoDiscardedUntil (double seconds) { videoDiscardedUntil = seconds; }
+
     virtual int                 getNumVideoStreams() const = 0;
     virtual VideoStreamSettings getVideoSettings (int streamIndex) const = 0;
     virtual int                 getNumAudioStreams() const = 0;
@@ -83,6 +105,11 @@ public:
 protected:
     bool   opened    = false;
 
+    FrameCache*  frameCache = nullptr;
+    juce::String frameCacheMedia;
+
+    std::atomic<double> videoDiscardedUntil { 0.0 };
+
 private:
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AVReader)
@@ -44,6 +44,16 @@ public:
 
     virtual void pushImage (int64_t pos, juce::Image image, int stream = 0) = 0;
 
+    /**
+     Push a frame, that shows the same image as the previous frame, e.g. in a section of still
+     images. A writer can override this to repeat the previous frame instead of encoding the
+     image again. The default pushes the image again.
+     */
+    virtual void pushDuplicateImage (int64_t pos, juce::Image image, int stream = 0)
+    {
+        pushImage (pos, image, stream);
+    }
+
     virtual int addVideoStream (const VideoStreamSettings& settings) = 0;
 
     virtual int addAudioStream (const AudioStreamSettings& settings) = 0;
@@ -52,6 +52,16 @@ void ClipRenderer::setAudioSettings (const AudioStreamSettings& settings)
     audioSettings = settings;
 }
 
+void ClipRenderer::setStemOutput (StemOutput mode)
+{
+    stemOutput = mode;
+}
+
+ClipRenderer::StemOutput ClipRenderer::getStemOutput() const
+{
+    return stemOutput;
+}
+
 void ClipRenderer::startRendering (bool cancelRunningJob)
 {
     if (clip == nullptr || mediaFile.getFileName().isEmpty())
@@ -73,9 +83,27 @@ void ClipRenderer::startRendering (bool cancelRunningJob)
     if (clip->hasVideo())
         writer->addVideoStream (videoSettings);
 
+    stems.clear();
+    stemStreams.clear();
+    stemWriters.clear();
+
     if (clip->hasAudio())
+    {
         writer->addAudioStream (audioSettings);
 
+        if (auto* composed = dynamic_cast<ComposedClip*>(clip.get()))
+            if (stemOutput != StemOutput::None)
+                stems = composed->getAudioStems();
+
+        for (const auto& stemName : stems)
+        {
+            if (stemOutput == StemOutput::AudioStreams)
+                stemStreams.push_back (writer->addAudioStream (audioSettings));
+            else
+                stemWriters.push_back (createStemWriter (stemName));
+        }
+    }
+
     if (writer->startWriting())
         videoEngine.getThreadPool().addJob (&renderJob, false);
 }
@@ -84,6 +112,7 @@ void ClipRenderer::cancelRendering()
 {
     videoEngine.getThreadPool().removeJob (&renderJob, true, 1000);
     writer.reset();
+    stemWriters.clear();
 
     if (onRenderingFinished)
         onRenderingFinished (false);
@@ -94,6 +123,29 @@ bool ClipRenderer::isRendering() const
     return renderJob.isRunning();
 }
 
+std::unique_ptr<juce::AudioFormatWriter> ClipRenderer::createStemWriter (const juce::String& stemName) const
+{
+    auto file = mediaFile.getSiblingFile (mediaFile.getFileNameWithoutExtension() + "_" + juce::File::createLegalFileName (stemName) + ".wav");
+    file.deleteFile();
+
+    auto stream = file.createOutputStream();
+    if (stream == nullptr)
+    {
+        FOLEYS_LOG ("Could not create stem file: " << file.getFullPathName());
+        return {};
+    }
+
+    juce::WavAudioFormat format;
+    std::unique_ptr<juce::AudioFormatWriter> stemWriter (format.createWriterFor (stream.get(),
+                                                                                 audioSettings.timebase,
+                                                                                 static_cast<unsigned int> (audioSettings.numChannels),
+                                                                                 24, {}, 0));
+    if (stemWriter != nullptr)
+        stream.release();
+
+    return stemWriter;
+}
+
 //==============================================================================
 
 ClipRenderer::RenderJob::RenderJob (ClipRenderer& owner)
@@ -112,10 +164,16 @@ juce::ThreadPoolJob::JobStatus ClipRenderer::RenderJob::runJob()
     const auto totalDuration = bouncer.clip->getTotalLength();
     int64_t    audioPosition = 0;
     int64_t    videoPosition = - targetVideoSettings.defaultDuration;
+    int64_t    lastFrameIdentifier = -1;
 
     auto  targetClip = bouncer.clip;
+    auto* composedClip = dynamic_cast<ComposedClip*>(targetClip.get());
 
     buffer.setSize (targetAudioSettings.numChannels, targetAudioSettings.defaultNumSamples);
+
+    stemBuffers.resize (size_t (bouncer.stems.size()));
+    for (auto& stemBuffer : stemBuffers)
+        stemBuffer.setSize (targetAudioSettings.numChannels, targetAudioSettings.defaultNumSamples);
     targetClip->prepareToPlay (targetAudioSettings.defaultNumSamples, targetAudioSettings.timebase);
     targetClip->setNextReadPosition (0);
 
@@ -125,13 +183,34 @@ juce::ThreadPoolJob::JobStatus ClipRenderer::RenderJob::runJob()
                                                                  targetAudioSettings.defaultNumSamples));
 
         targetClip->waitForSamplesReady (info.numSamples);
-        targetClip->getNextAudioBlock (info);
+
+        if (composedClip != nullptr && ! stemBuffers.empty())
+            composedClip->getNextAudioBlockWithStems (info, stemBuffers);
+        else
+            targetClip->getNextAudioBlock (info);
+
         juce::AudioBuffer<float> writeBuffer (buffer.getArrayOfWritePointers(),
                                               buffer.getNumChannels(),
                                               info.startSample,
                                               info.numSamples);
         bouncer.writer->pushSamples (writeBuffer);
 
+        for (size_t stem = 0; stem < stemBuffers.size(); ++stem)
+        {
+            if (stem < bouncer.stemStreams.size())
+            {
+                juce::AudioBuffer<float> stemBuffer (stemBuffers [stem].getArrayOfWritePointers(),
+                                                     stemBuffers [stem].getNumChannels(),
+                                                     0,
+                                                     info.numSamples);
+                bouncer.writer->pushSamples (stemBuffer, bouncer.stemStreams [stem]);
+            }
+            else if (stem < bouncer.stemWriters.size() && bouncer.stemWriters [stem] != nullptr)
+            {
+                bouncer.stemWriters [stem]->writeFromAudioSampleBuffer (stemBuffers [stem], 0, info.numSamples);
+            }
+        }
+
         audioPosition += writeBuffer.getNumSamples();
 
         const auto secs = audioPosition / double (targetAudioSettings.timebase);
@@ -155,7 +234,14 @@ juce::ThreadPoolJob::JobStatus ClipRenderer::RenderJob::runJob()
 
             auto& frame = targetClip->getFrame (timestamp);
 
-            bouncer.writer->pushImage (videoPosition, frame.image);
+            // the writer can encode a repeated image cheaper
+            const auto frameIdentifier = targetClip->getFrameIdentifier (timestamp);
+            if (frameIdentifier >= 0 && frameIdentifier == lastFrameIdentifier)
+                bouncer.writer->pushDuplicateImage (videoPosition, frame.image);
+            else
+                bouncer.writer->pushImage (videoPosition, frame.image);
+
+            lastFrameIdentifier = frameIdentifier;
         }
 
         bouncer.progress.store (double (audioPosition) / totalDuration);
@@ -163,6 +249,7 @@ juce::ThreadPoolJob::JobStatus ClipRenderer::RenderJob::runJob()
 
     bouncer.writer->finishWriting();
     bouncer.writer.reset();
+    bouncer.stemWriters.clear();
 
     bouncer.progress.store (1.0);
 
@@ -36,6 +36,21 @@ public:
     void setVideoSettings (const VideoStreamSettings& settings);
     void setAudioSettings (const AudioStreamSettings& settings);
 
+    /** Defines, how the stems of a ComposedClip are written */
+    enum class StemOutput
+    {
+        None,           ///< only the master is written
+        AudioStreams,   ///< each stem is written as additional audio stream into the output file
+        SidecarFiles    ///< each stem is written into a wav file next to the output file
+    };
+
+    /**
+     If the clip to render is a ComposedClip with stems (see ComposedClip::setAudioStems()),
+     the stems can be written in the same pass as the master, so each source is only read once.
+     */
+    void setStemOutput (StemOutput mode);
+    StemOutput getStemOutput() const;
+
     void startRendering (bool cancelRunningJob);
     void cancelRendering();
     bool isRendering() const;
@@ -54,10 +69,13 @@ private:
     private:
         ClipRenderer& bouncer;
         juce::AudioBuffer<float> buffer;
+        std::vector<juce::AudioBuffer<float>> stemBuffers;
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderJob)
     };
 
+    std::unique_ptr<juce::AudioFormatWriter> createStemWriter (const juce::String& stemName) const;
+
     VideoEngine&              videoEngine;
 
     VideoStreamSettings videoSettings;
@@ -67,6 +85,11 @@ private:
     std::unique_ptr<AVWriter> writer;
     std::shared_ptr<AVClip>   clip;
 
+    StemOutput                stemOutput = StemOutput::None;
+    juce::StringArray         stems;
+    std::vector<int>          stemStreams;
+    std::vector<std::unique_ptr<juce::AudioFormatWriter>> stemWriters;
+
     RenderJob renderJob;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClipRenderer)
@@ -22,25 +22,33 @@
 
 #include "Basics/foleys_Usage.cpp"
 #include "Basics/foleys_VideoFifo.cpp"
+#include "Basics/foleys_FrameCache.cpp"
+#include "Basics/foleys_RenderCache.cpp"
 #include "Basics/foleys_AudioFifo.cpp"
 #include "Basics/foleys_VideoEngine.cpp"
 #include "Basics/foleys_TimeCodeAware.cpp"
+#include "Basics/foleys_WorkerPool.cpp"
 
 #include "Clips/foleys_AVClip.cpp"
 #include "Clips/foleys_AudioClip.cpp"
 #include "Clips/foleys_ImageClip.cpp"
 #include "Clips/foleys_MovieClip.cpp"
+#include "Clips/foleys_MulticamClip.cpp"
 #include "Clips/foleys_ComposedClip.cpp"
 #include "Clips/foleys_ClipDescriptor.cpp"
+#include "Clips/foleys_ClipTimeline.cpp"
 
 #include "Plugins/foleys_AudioPluginManager.cpp"
 #include "Plugins/foleys_VideoPluginManager.cpp"
 
 #include "Processing/foleys_ControllableBase.cpp"
+#include "Processing/foleys_AutomationCurve.cpp"
 #include "Processing/foleys_ParameterAutomation.cpp"
 #include "Processing/foleys_ProcessorParameter.cpp"
 #include "Processing/foleys_ProcessorController.cpp"
+#include "Processing/foleys_AudioBus.cpp"
 #include "Processing/foleys_DefaultAudioMixer.cpp"
+#include "Processing/foleys_Compositor.cpp"
 
 #include "ReadWrite/foleys_AVFormatManager.cpp"
 #include "ReadWrite/foleys_ClipRenderer.cpp"
@@ -113,15 +113,23 @@
 #include "Basics/foleys_TimeCodeAware.h"
 #include "Basics/foleys_AudioFifo.h"
 #include "Basics/foleys_VideoFifo.h"
+#include "Basics/foleys_FrameCache.h"
+#include "Basics/foleys_RenderCache.h"
+#include "Basics/foleys_AtomicSnapshot.h"
+#include "Basics/foleys_WorkerPool.h"
+#include "Processing/foleys_Compositor.h"
 #include "Processing/foleys_ProcessorParameter.h"
 #include "Plugins/foleys_AudioPluginManager.h"
 #include "Plugins/foleys_VideoProcessor.h"
 #include "Plugins/foleys_VideoPluginManager.h"
 #include "Processing/foleys_ControllableBase.h"
 #include "Processing/foleys_ProcessorController.h"
+#include "Processing/foleys_AutomationCurve.h"
 #include "Processing/foleys_ParameterAutomation.h"
 #include "Clips/foleys_AVClip.h"
 #include "Clips/foleys_ClipDescriptor.h"
+#include "Processing/foleys_AudioBus.h"
+#include "Clips/foleys_ClipTimeline.h"
 #include "ReadWrite/foleys_AVReader.h"
 #include "ReadWrite/foleys_AVWriter.h"
 #include "ReadWrite/foleys_AVFormatManager.h"
@@ -134,6 +142,7 @@
 #include "Clips/foleys_AudioClip.h"
 #include "Clips/foleys_ImageClip.h"
 #include "Clips/foleys_MovieClip.h"
+#include "Clips/foleys_MulticamClip.h"
 #include "Clips/foleys_ComposedClip.h"
 
 #include "Basics/foleys_VideoEngine.h"